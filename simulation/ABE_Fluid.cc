@@ -0,0 +1,573 @@
+/*
+* Fluid model screening of ABE parameter spaces
+*
+* Runs the fluid model of abe-fluid.h over a grid or a list of points, in
+* seconds for spaces the packet-level ABE_Simulation.cc would need days for,
+* then narrows them down to the points worth simulating:
+*
+* - fluid.csv holds the modelled metrics of every point, named after the
+*   config.txt keys of the simulation.
+* - --select=N writes the N points on (or nearest to) the Pareto front of
+*   utilization against queueing delay to selected.csv, a points file for
+*   ABE_Sweep.cc --points.
+* - --compare=<results.csv> reruns the model on the points of a sweep and
+*   reports its error against the simulated metrics, to check how far the
+*   model can be trusted for a scenario.
+*
+* Keys are the ABE_Simulation options and ns-3 attributes the model knows
+* (see ApplyKey()); other keys, such as RngRun, do not change the model and
+* are reported once.
+*
+* Note: This tool has no ns-3 dependency, build it with
+*       g++ -std=c++17 -O3 -march=native -ffast-math -fopenmp-simd -o abe-fluid ABE_Fluid.cc
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "abe-fluid.h"
+#include "abe-grid.h"
+
+/**
+* @brief Parse a number with an ns-3 unit suffix.
+* @param value The value, e.g. "10ms", "100Mbps" or "5".
+* @param units Scale of every suffix.
+* @param result Set to the value in the base unit.
+* @return False if the number or the suffix is malformed.
+*/
+static bool
+ParseWithUnit(const std::string& value, const std::map<std::string, double>& units, double& result)
+{
+    char* end;
+    double number = strtod(value.c_str(), &end);
+    if (end == value.c_str())
+    {
+        return false;
+    }
+    std::string suffix = end;
+    auto it = units.find(suffix);
+    if (it == units.end())
+    {
+        return false;
+    }
+    result = number * it->second;
+    return true;
+}
+
+/**
+* @brief Set one model parameter from a simulation key.
+* @param params The point parameters.
+* @param key The ABE_Simulation option or ns-3 attribute.
+* @param value Its value.
+* @return False if the model does not know the key or cannot parse the value.
+*/
+static bool
+ApplyKey(FluidParams& params, const std::string& key, const std::string& value)
+{
+    static const std::map<std::string, double> times = {{"", 1}, {"s", 1}, {"ms", 1e-3}, {"us", 1e-6}};
+    static const std::map<std::string, double> rates = {{"", 1},
+                                                        {"bps", 1},
+                                                        {"kbps", 1e3},
+                                                        {"Kbps", 1e3},
+                                                        {"Mbps", 1e6},
+                                                        {"Gbps", 1e9}};
+    static const std::map<std::string, double> plain = {{"", 1}};
+    auto isTrue = [](const std::string& v) { return v == "true" || v == "1"; };
+    auto isCubic = [](const std::string& v) { return v == "TcpCubic" || v == "ns3::TcpCubic"; };
+    auto isReno = [](const std::string& v) { return v == "TcpLinuxReno" || v == "ns3::TcpLinuxReno"; };
+
+    double number;
+    if (key == "aqm")
+    {
+        return value == "red";
+    }
+    if (key == "tcpTypeId" || key == "altTcpTypeId")
+    {
+        if (!isCubic(value) && !isReno(value))
+        {
+            return false;
+        }
+        (key == "tcpTypeId" ? params.cubic : params.altCubic) = isCubic(value);
+        return true;
+    }
+    if (key == "useEcn" || key == "AdaptMaxP")
+    {
+        (key == "useEcn" ? params.useEcn : params.adaptMaxP) = isTrue(value);
+        return true;
+    }
+    if (key == "nSenders")
+    {
+        if (!ParseWithUnit(value, plain, number) || number < 1)
+        {
+            return false;
+        }
+        params.nSenders = static_cast<uint32_t>(number);
+        return true;
+    }
+    if (key == "dataSize")
+    {
+        if (!ParseWithUnit(value, plain, number) || number < 1)
+        {
+            return false;
+        }
+        params.dataSize = static_cast<uint32_t>(number);
+        return true;
+    }
+    if (key == "stopTime" || key == "startSpread" || key == "bottleneckDelay")
+    {
+        if (!ParseWithUnit(value, times, number))
+        {
+            return false;
+        }
+        (key == "stopTime" ? params.stopTime
+                           : (key == "startSpread" ? params.startSpread : params.bottleneckDelay)) =
+            number;
+        return true;
+    }
+    if (key == "bottleneckBandwidth")
+    {
+        return ParseWithUnit(value, rates, params.bandwidth);
+    }
+
+    static const std::map<std::string, double FluidParams::*> numbers = {
+        {"minTh", &FluidParams::minTh},
+        {"maxTh", &FluidParams::maxTh},
+        {"QW", &FluidParams::qW},
+        {"abeFraction", &FluidParams::abeFraction},
+        {"altTcpFraction", &FluidParams::altTcpFraction},
+        {"ns3::TcpCubic::Beta", &FluidParams::cubicBeta},
+        {"ns3::TcpCubic::BetaEcn", &FluidParams::cubicBetaEcn},
+        {"ns3::TcpLinuxReno::Beta", &FluidParams::renoBeta},
+        {"ns3::TcpLinuxReno::BetaEcn", &FluidParams::renoBetaEcn},
+    };
+    auto it = numbers.find(key);
+    if (it == numbers.end())
+    {
+        return false;
+    }
+    return ParseWithUnit(value, plain, params.*(it->second));
+}
+
+/**
+* @brief Build the model parameters of every point.
+* @param keys The keys of the point values.
+* @param points One value per key for every point.
+* @param extraArgs "--key=value" arguments applied to every point first.
+* @return The parameters of every point.
+*/
+static std::vector<FluidParams>
+BuildParams(const std::vector<std::string>& keys,
+            const std::vector<std::vector<std::string>>& points,
+            const std::vector<std::string>& extraArgs)
+{
+    FluidParams base;
+    std::set<std::string> ignored;
+    std::set<std::string> used(keys.begin(), keys.end());
+    for (const std::string& arg : extraArgs)
+    {
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        std::string value = eq == std::string::npos ? "true" : arg.substr(eq + 1);
+        if (arg.rfind("--", 0) != 0 || !ApplyKey(base, key, value))
+        {
+            ignored.insert(key);
+        }
+        used.insert(key);
+    }
+
+    std::vector<FluidParams> params(points.size(), base);
+    for (size_t j = 0; j < points.size(); j++)
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (!ApplyKey(params[j], keys[i], points[j][i]))
+            {
+                ignored.insert(keys[i]);
+            }
+        }
+    }
+    for (const std::string& key : ignored)
+    {
+        std::cerr << "Warning: " << key << " (or one of its values) is not modelled, ignored"
+                  << std::endl;
+    }
+    // The red preset enables ARED, which sets these from the link rate
+    for (const char* key : {"minTh", "maxTh", "QW"})
+    {
+        if (used.count(key) && base.ared)
+        {
+            std::cerr << "Warning: " << key << " is replaced by the automatic ARED value of the"
+                      << " red preset, in the simulation as in the model" << std::endl;
+        }
+    }
+    return params;
+}
+
+/**
+* @brief Get a named metric of a result.
+* @param result The result.
+* @param name The config.txt key.
+* @param value Set to the metric.
+* @return False if the model has no such metric.
+*/
+static bool
+GetMetric(const FluidResult& result, const std::string& name, double& value)
+{
+    static const std::map<std::string, double FluidResult::*> metrics = {
+        {"avgThroughput", &FluidResult::avgThroughput},
+        {"goodputMbpsMean", &FluidResult::goodputMbpsMean},
+        {"utilizationMean", &FluidResult::utilizationMean},
+        {"avgQueueSize", &FluidResult::avgQueueSize},
+        {"queueDelayMsMean", &FluidResult::queueDelayMsMean},
+        {"ecnReductions", &FluidResult::ecnReductions},
+        {"lossReductions", &FluidResult::lossReductions},
+    };
+    auto it = metrics.find(name);
+    if (it == metrics.end())
+    {
+        return false;
+    }
+    value = result.*(it->second);
+    return true;
+}
+
+/// Metric names in fluid.csv column order
+static const std::vector<std::string> METRICS = {"avgThroughput",
+                                                 "goodputMbpsMean",
+                                                 "utilizationMean",
+                                                 "avgQueueSize",
+                                                 "queueDelayMsMean",
+                                                 "ecnReductions",
+                                                 "lossReductions"};
+
+/**
+* @brief Rank points by Pareto fronts of utilization (higher is better)
+*        against queueing delay (lower is better).
+* @param results The results of every point.
+* @param count Number of points wanted.
+* @return At least count point indices (or all), the first front first, then
+*         the front left once it is removed, and so on.
+*/
+static std::vector<size_t>
+ParetoOrder(const std::vector<FluidResult>& results, size_t count)
+{
+    std::vector<size_t> left(results.size());
+    for (size_t j = 0; j < left.size(); j++)
+    {
+        left[j] = j;
+    }
+    // From the lowest delay up, a point is on the front if no point with less
+    // delay reaches its utilization
+    std::sort(left.begin(), left.end(), [&results](size_t a, size_t b) {
+        if (results[a].queueDelayMsMean != results[b].queueDelayMsMean)
+        {
+            return results[a].queueDelayMsMean < results[b].queueDelayMsMean;
+        }
+        return results[a].utilizationMean > results[b].utilizationMean;
+    });
+    std::vector<size_t> order;
+    while (order.size() < count && !left.empty())
+    {
+        std::vector<size_t> rest;
+        double best = -1;
+        for (size_t a : left)
+        {
+            if (results[a].utilizationMean > best)
+            {
+                best = results[a].utilizationMean;
+                order.push_back(a);
+            }
+            else
+            {
+                rest.push_back(a);
+            }
+        }
+        left.swap(rest);
+    }
+    return order;
+}
+
+/**
+* @brief Write the points and their results.
+* @param path The CSV file path.
+* @param keys The keys of the point values.
+* @param points One value per key for every point.
+* @param results The results of every point.
+*/
+static void
+WriteResults(const std::string& path,
+             const std::vector<std::string>& keys,
+             const std::vector<std::vector<std::string>>& points,
+             const std::vector<FluidResult>& results)
+{
+    std::ofstream out(path, std::ios::out);
+    out << "point";
+    for (const std::string& key : keys)
+    {
+        out << "," << key;
+    }
+    for (const std::string& metric : METRICS)
+    {
+        out << "," << metric;
+    }
+    out << "\n";
+    for (size_t j = 0; j < points.size(); j++)
+    {
+        out << j;
+        for (const std::string& value : points[j])
+        {
+            out << "," << value;
+        }
+        for (const std::string& metric : METRICS)
+        {
+            double value = 0;
+            GetMetric(results[j], metric, value);
+            out << "," << value;
+        }
+        out << "\n";
+    }
+}
+
+/**
+* @brief Compare the model against the results table of a sweep.
+* @param path The results.csv of ABE_Sweep.cc.
+* @param outputDir Directory of compare.csv.
+* @param extraArgs Arguments applied to every point.
+* @param maxStep Longest time step of the model.
+* @param maxSteps Largest number of steps of the model.
+* @return False if the table cannot be used.
+*/
+static bool
+Compare(const std::string& path,
+        const std::string& outputDir,
+        const std::vector<std::string>& extraArgs,
+        double maxStep,
+        uint64_t maxSteps)
+{
+    // results.csv: run, the point keys, status, wallSeconds, then the metrics
+    std::vector<std::string> columns;
+    std::vector<std::vector<std::string>> rows = ReadPoints(path, columns);
+    auto status = std::find(columns.begin(), columns.end(), "status");
+    if (columns.empty() || columns[0] != "run" || status == columns.end())
+    {
+        std::cerr << path << " is not a results table of ABE_Sweep" << std::endl;
+        return false;
+    }
+    size_t statusColumn = status - columns.begin();
+    std::vector<std::string> keys(columns.begin() + 1, status);
+    std::vector<std::vector<std::string>> points;
+    std::vector<size_t> used;
+    for (size_t r = 0; r < rows.size(); r++)
+    {
+        if (rows[r][statusColumn] == "0")
+        {
+            points.emplace_back(rows[r].begin() + 1, rows[r].begin() + statusColumn);
+            used.push_back(r);
+        }
+    }
+
+    std::vector<FluidResult> results =
+        FluidModel(BuildParams(keys, points, extraArgs), maxStep, maxSteps).Run();
+
+    std::ofstream out(outputDir + "/compare.csv", std::ios::out);
+    out << "run,metric,simulated,fluid,absError,relError\n";
+    std::cout << std::left << std::setw(20) << "metric" << std::right << std::setw(8) << "runs"
+              << std::setw(16) << "meanAbsError" << std::setw(16) << "meanRelError" << std::endl;
+    bool any = false;
+    for (size_t c = statusColumn + 1; c < columns.size(); c++)
+    {
+        double model;
+        if (!GetMetric(FluidResult(), columns[c], model))
+        {
+            continue;
+        }
+        double absSum = 0;
+        double relSum = 0;
+        uint32_t count = 0;
+        for (size_t j = 0; j < used.size(); j++)
+        {
+            const std::string& cell = rows[used[j]][c];
+            char* end;
+            double simulated = strtod(cell.c_str(), &end);
+            if (cell.empty() || *end != '\0')
+            {
+                continue;
+            }
+            GetMetric(results[j], columns[c], model);
+            double absError = std::abs(model - simulated);
+            double relError = simulated != 0 ? absError / std::abs(simulated) : 0;
+            out << rows[used[j]][0] << "," << columns[c] << "," << simulated << "," << model << ","
+                << absError << "," << relError << "\n";
+            absSum += absError;
+            relSum += relError;
+            count++;
+        }
+        if (count)
+        {
+            any = true;
+            std::cout << std::left << std::setw(20) << columns[c] << std::right << std::setw(8)
+                      << count << std::setw(16) << absSum / count << std::setw(16)
+                      << relSum / count << std::endl;
+        }
+    }
+    if (!any)
+    {
+        std::cerr << "No metric of " << path << " is modelled, collect e.g. "
+                  << "--metrics=avgThroughput,avgQueueSize,goodputMbpsMean,queueDelayMsMean"
+                  << std::endl;
+        return false;
+    }
+    std::cout << "Errors per run written to " << outputDir << "/compare.csv" << std::endl;
+    return true;
+}
+
+int
+main(int argc, char* argv[])
+{
+    // Default configuration values
+    std::string gridFile = "";
+    std::string pointsFile = "";
+    std::string compareFile = "";
+    std::string outputDir = "";
+    double maxStep = 1e-3;
+    uint64_t maxSteps = 10000000;
+    size_t select = 0;
+    std::vector<std::string> extraArgs;
+
+    // Parse command-line arguments, anything unknown is applied to every point
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--grid=", 0) == 0)
+        {
+            gridFile = arg.substr(7);
+        }
+        else if (arg.rfind("--points=", 0) == 0)
+        {
+            pointsFile = arg.substr(9);
+        }
+        else if (arg.rfind("--compare=", 0) == 0)
+        {
+            compareFile = arg.substr(10);
+        }
+        else if (arg.rfind("--outputDir=", 0) == 0)
+        {
+            outputDir = arg.substr(12);
+        }
+        else if (arg.rfind("--dt=", 0) == 0)
+        {
+            maxStep = std::stod(arg.substr(5));
+        }
+        else if (arg.rfind("--maxSteps=", 0) == 0)
+        {
+            maxSteps = std::stoull(arg.substr(11));
+        }
+        else if (arg.rfind("--select=", 0) == 0)
+        {
+            select = std::stoul(arg.substr(9));
+        }
+        else if (arg == "--help")
+        {
+            std::cout << "Usage: " << argv[0]
+                      << " --grid=<file> | --points=<file> | --compare=<sweep results.csv>"
+                         " [--outputDir=<dir>] [--select=N] [--dt=<seconds>] [--maxSteps=N]"
+                         " [--<simulation arg>=<value> ...]"
+                      << std::endl;
+            return 0;
+        }
+        else
+        {
+            extraArgs.push_back(arg);
+        }
+    }
+    if (!gridFile.empty() + !pointsFile.empty() + !compareFile.empty() != 1)
+    {
+        std::cerr << "One of a grid file, a points file or a results table is required, see --help"
+                  << std::endl;
+        return 1;
+    }
+    if (maxStep <= 0 || maxSteps < 1)
+    {
+        std::cerr << "--dt and --maxSteps must be positive" << std::endl;
+        return 1;
+    }
+
+    // Create output directory
+    if (outputDir.empty())
+    {
+        time_t rawtime;
+        struct tm* timeinfo;
+        char buffer[80];
+        time(&rawtime);
+        timeinfo = localtime(&rawtime);
+        strftime(buffer, sizeof(buffer), "%d-%m-%Y-%I-%M-%S", timeinfo);
+        outputDir = "fluid-results/" + std::string(buffer);
+    }
+    std::filesystem::create_directories(outputDir);
+
+    if (!compareFile.empty())
+    {
+        return Compare(compareFile, outputDir, extraArgs, maxStep, maxSteps) ? 0 : 1;
+    }
+
+    std::vector<std::string> keys;
+    std::vector<std::vector<std::string>> points;
+    if (!pointsFile.empty())
+    {
+        points = ReadPoints(pointsFile, keys);
+    }
+    else
+    {
+        std::vector<GridAxis> grid = ParseGrid(gridFile);
+        for (const GridAxis& axis : grid)
+        {
+            keys.push_back(axis.key);
+        }
+        points = GridPoints(grid);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    FluidModel model(BuildParams(keys, points, extraArgs), maxStep, maxSteps);
+    std::vector<FluidResult> results = model.Run();
+    double wallSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << points.size() << " points, " << model.GetSteps() << " steps each, in "
+              << std::fixed << std::setprecision(2) << wallSeconds << "s" << std::endl;
+
+    WriteResults(outputDir + "/fluid.csv", keys, points, results);
+    std::cout << "Results written to " << outputDir << "/fluid.csv" << std::endl;
+
+    // Points for the packet-level sweep, best trade-offs first
+    if (select)
+    {
+        std::vector<size_t> order = ParetoOrder(results, select);
+        std::ofstream out(outputDir + "/selected.csv", std::ios::out);
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            out << (i ? "," : "") << keys[i];
+        }
+        out << "\n";
+        for (size_t n = 0; n < std::min(select, order.size()); n++)
+        {
+            const std::vector<std::string>& values = points[order[n]];
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                out << (i ? "," : "") << values[i];
+            }
+            out << "\n";
+        }
+        std::cout << std::min(select, order.size()) << " points written to " << outputDir
+                  << "/selected.csv, run them with abe-sweep --points" << std::endl;
+    }
+    return 0;
+}
@@ -6,10 +6,31 @@
 *
 * Features:
 * - Configurable TCP variant (Cubic, NewReno).
-* - RED queue management with ECN support.
-* - Flow monitoring for throughput and queue size.
-* - Congestion window tracing.
-* - PCAP file generation for debugging.
+* - Multi-flow mode: N senders, M receivers, one or more bottlenecks (parking lot),
+*   with a configurable mix of ABE/non-ABE flows and congestion controls.
+* - Per-flow throughput, Jain's fairness index and delay percentiles.
+* - Online mean, variance and quantiles of queue delay, queue length, cwnd,
+*   goodput and utilization, written as one JSON summary (see abe-stats.h).
+* - AQM presets with ECN marking: RED, CoDel, FqCoDel, PIE and FqPIE (see abe-aqm.h).
+* - Event-driven queue length, ECN mark, drop and sojourn time instrumentation
+*   of the last bottleneck (see abe-queue-probe.h).
+* - Incremental per-flow throughput and goodput sampling (see abe-flow-probe.h).
+* - Congestion window tracing of any set of flows, decimated by time or by change
+*   (see abe-cwnd-tracer.h).
+* - Short-flow workload from an empirical flow size CDF with Poisson arrivals over
+*   pooled persistent connections, with flow completion time percentiles by flow
+*   size and ABE setting (see abe-workload.h).
+* - Profiling mode: wall-clock time per event type and trace sink, event rate,
+*   peak memory and memory estimates of FlowMonitor and the queue discs
+*   (see abe-profiler.h).
+* - Buffered text or binary columnar trace files (see abe-trace.h).
+* - Snapshot branches: several ABE parameter sets forked from one warmed-up
+*   run (see abe-snapshot.h).
+* - Distributed execution over MPI logical processes (NS-3 built with --enable-mpi).
+* - Seeded replicas run in parallel, with 95% confidence intervals of throughput
+*   and queue delay, in content-addressed output directories (see abe-replicas.h).
+* - PCAP file generation for debugging, in full or as a bounded, filtered ring of
+*   header-only captures (see abe-pcap.h).
 
 * Note: Make sure to add this test file in sratch folder 
 */
@@ -23,80 +44,902 @@
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/traffic-control-module.h"
-#include "ns3/red-queue-disc.h"
 #include "ns3/callback.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+
+#include <mpi.h>
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <optional>
+
+#include "abe-aqm.h"
+#include "abe-cwnd-tracer.h"
+#include "abe-flow-probe.h"
+#include "abe-pcap.h"
+#include "abe-profiler.h"
+#include "abe-queue-probe.h"
+#include "abe-replicas.h"
+#include "abe-snapshot.h"
+#include "abe-stats.h"
+#include "abe-trace.h"
+#include "abe-workload.h"
 
 using namespace ns3;
 
 // Global variables for output files and directory
-std::string dir;               
-std::ofstream throughputFile; 
-std::ofstream queueSizeFile;   
+std::string dir;
+TraceWriter throughputFile;
+TraceWriter goodputFile;
+TraceWriter queueSizeFile;
+TraceWriter cwndFile;
+FILE* queueEventsFile = nullptr;
+
+// Running sums for the per-run summary written to config.txt
+double throughputSum = 0;
+uint32_t throughputSamples = 0;
+
+// Online summaries of the sampled metrics, written to summary.json
+OnlineSummary queueDelayMs(1e-3);
+OnlineSummary queueSizePackets(1e-2);
+OnlineSummary cwndSegments(1e-2);
+OnlineSummary goodputMbps(1e-3);
+OnlineSummary workloadGoodputMbps(1e-3);
+OnlineSummary utilization(1e-4);
+double bottleneckRateMbps = 0;
+
+// Profiling scheduler, null unless profiling, and the trace sinks it times,
+// registered in this order
+ProfilingSimulatorImpl* profiler = nullptr;
 
-// Previous values for throughput calculation
-uint32_t prevTxBytes = 0;
-Time prevTime = Seconds(0);
+enum ProfiledSink
+{
+    SINK_QUEUE_BIN,
+    SINK_CWND_SAMPLE,
+    SINK_SOJOURN,
+    SINK_REDUCTION,
+    SINK_PCAP,
+    SINK_FLOW_MONITOR
+};
 
 /**
-* @brief Trace throughput and log it to a file.
-* @param monitor The FlowMonitor instance.
+* @brief Static description of one bulk flow of the scenario.
+*/
+struct FlowConfig
+{
+    uint32_t sender;       //!< Index of the sender node
+    uint32_t receiver;     //!< Index of the receiver node
+    uint32_t hops;         //!< Number of bottleneck links crossed
+    std::string tcpTypeId; //!< Congestion control of the flow
+    bool abe;              //!< Whether the flow backs off by BetaEcn on ECN marks
+    Time start;            //!< Start time of the application
+    Ptr<Application> app;  //!< BulkSend application of the flow, null on other ranks
+    Ptr<TcpSocketState> tcb;    //!< Socket state of the flow, null until it starts
+    uint32_t ecnReductions{0};  //!< Window reductions caused by ECN-Echo
+    uint32_t lossReductions{0}; //!< Window reductions caused by loss
+};
+
+std::vector<FlowConfig> flows;
+
+/**
+* @brief Run totals of the instrumented bottleneck queue, written to config.txt.
+*/
+struct QueueTotals
+{
+    double avgPackets{0};   //!< Time-averaged queue length
+    double enqueues{0};     //!< Packets enqueued
+    double marks{0};        //!< Packets ECN-marked
+    double earlyDrops{0};   //!< Packets dropped early
+    double forcedDrops{0};  //!< Packets dropped forcibly
+    double sojournP99Ms{0}; //!< 99th percentile of the sojourn time histogram
+};
+
+/**
+* @brief Trace throughput and goodput of the flows active in the last interval.
+*
+* Only flows that sent or received bytes during the interval are logged; a
+* missing sample means zero. The avgThroughput summary follows flow 0.
+*
+* The congestion window of every started bulk flow is added to the cwnd
+* summary at the same time. Polling costs one read per flow and interval,
+* however often the windows change, and weighs every sample by the same time.
+*
+* The goodput of the workload is sampled separately, and the utilization counts
+* the goodput of the bulk flows and of the workload together.
+*
+* @param probe The per-flow byte counters.
+* @param workload The workload generator, null without a workload.
+* @param workloadRxBytes Bytes received by the workload at the previous sample.
+* @param interval The sampling interval.
 */
 static void
-TraceThroughput(Ptr<FlowMonitor> monitor)
+TraceThroughput(FlowDeltaProbe* probe,
+                const WorkloadGenerator* workload,
+                uint64_t workloadRxBytes,
+                Time interval)
 {
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
-    if (!stats.empty())
-    {
-        auto itr = stats.begin();
-        Time curTime = Now();
-        throughputFile << curTime << " "
-                    << 8 * (itr->second.txBytes - prevTxBytes) / ((curTime - prevTime).ToDouble(Time::US))
-                    << std::endl;
-        prevTime = curTime;
-        prevTxBytes = itr->second.txBytes;
-    }
-    Simulator::Schedule(Seconds(0.2), &TraceThroughput, monitor);
+    int64_t now = Simulator::Now().GetNanoSeconds();
+    double intervalUs = interval.ToDouble(Time::US);
+    double flow0Throughput = 0;
+    uint64_t rxBytes = 0;
+    for (const auto& delta : probe->Collect())
+    {
+        rxBytes += delta.rxBytes;
+        double throughput = 8 * delta.txBytes / intervalUs;
+        if (delta.txBytes > 0)
+        {
+            throughputFile.Write(now, throughput, delta.flowId);
+        }
+        if (delta.rxBytes > 0)
+        {
+            goodputFile.Write(now, 8 * delta.rxBytes / intervalUs, delta.flowId);
+        }
+        if (delta.flowId == 0)
+        {
+            flow0Throughput = throughput;
+        }
+    }
+    throughputSum += flow0Throughput;
+    throughputSamples++;
+    double goodput = 8 * rxBytes / intervalUs;
+    goodputMbps.Add(goodput);
+    double linkGoodput = goodput;
+    if (workload)
+    {
+        double workloadGoodput = 8 * (workload->GetRxBytes() - workloadRxBytes) / intervalUs;
+        workloadRxBytes = workload->GetRxBytes();
+        workloadGoodputMbps.Add(workloadGoodput);
+        linkGoodput += workloadGoodput;
+    }
+    utilization.Add(linkGoodput / bottleneckRateMbps);
+    for (const FlowConfig& flow : flows)
+    {
+        if (flow.tcb)
+        {
+            cwndSegments.Add(static_cast<double>(flow.tcb->m_cWnd) / flow.tcb->m_segmentSize);
+        }
+    }
+    Simulator::Schedule(interval, &TraceThroughput, probe, workload, workloadRxBytes, interval);
 }
 
 /**
-* @brief Trace queue size and log it to a file.
-* @param qd The QueueDisc instance.
+* @brief Log one time bin of the bottleneck queue: the average queue length to
+*        the queue size trace, all counters to queueEvents.csv.
+* @param bin The closed time bin.
 */
-void
-CheckQueueSize(Ptr<QueueDisc> qd)
+static void
+QueueBinTracer(const QueueEventProbe::Bin& bin)
 {
-    uint32_t qsize = qd->GetCurrentSize().GetValue();
-    queueSizeFile << Simulator::Now().GetSeconds() << " " << qsize << std::endl;
-    Simulator::Schedule(Seconds(0.2), &CheckQueueSize, qd);
+    ProfileScope scope(profiler, SINK_QUEUE_BIN);
+    queueSizeFile.Write(bin.start.GetNanoSeconds(), bin.avgPackets);
+    queueSizePackets.Add(bin.avgPackets);
+    fprintf(queueEventsFile,
+            "%g,%g,%u,%u,%u,%u,%u\n",
+            bin.start.GetSeconds(),
+            bin.avgPackets,
+            bin.maxPackets,
+            bin.enqueues,
+            bin.marks,
+            bin.earlyDrops,
+            bin.forcedDrops);
 }
 
 /**
-* @brief Trace congestion window and log it to a file.
-* @param stream The output stream.
-* @param oldval Old CWND value.
-* @param newval New CWND value.
+* @brief Log a congestion window sample of a traced flow to the cwnd file.
+* @param flowId The flow id.
+* @param time Time of the sample.
+* @param segments Congestion window in segments.
 */
 static void
-CwndTracer(Ptr<OutputStreamWrapper> stream, uint32_t oldval, uint32_t newval)
+CwndSampleTracer(uint32_t flowId, Time time, double segments)
+{
+    ProfileScope scope(profiler, SINK_CWND_SAMPLE);
+    cwndFile.Write(time.GetNanoSeconds(), segments, flowId);
+}
+
+/**
+* @brief Add the sojourn time of a dequeued packet to the queue delay summary.
+* @param sojourn Time the packet spent in the queue disc.
+*/
+static void
+SojournTracer(Time sojourn)
+{
+    ProfileScope scope(profiler, SINK_SOJOURN);
+    queueDelayMs.Add(sojourn.ToDouble(Time::MS));
+}
+
+/**
+* @brief Count the window reductions of a flow by cause.
+* @param flowIndex Index of the flow in flows.
+* @param oldCwnd Congestion window before the reduction.
+* @param newSsThresh Slow start threshold the reduction sets.
+* @param cause Cause of the reduction.
+*/
+static void
+ReductionTracer(uint32_t flowIndex,
+                uint32_t oldCwnd,
+                uint32_t newSsThresh,
+                TcpSocketState::ReductionCause_t cause)
+{
+    ProfileScope scope(profiler, SINK_REDUCTION);
+    if (cause == TcpSocketState::REDUCTION_ECN)
+    {
+        flows[flowIndex].ecnReductions++;
+    }
+    else
+    {
+        flows[flowIndex].lossReductions++;
+    }
+}
+
+/**
+* @brief Configure the socket of a flow once its application has created it.
+*
+* ABE is disabled on the sockets of flows without ABE, so they back off on ECN
+* marks exactly as on loss. The socket is reached
+* through the application, without a Config path lookup per flow.
+*
+* @param flowIndex Index of the flow in flows.
+* @param cwndSampler Sampler tracing the congestion window, null if the flow is not traced.
+*/
+void
+SetupFlow(uint32_t flowIndex, CwndSampler* cwndSampler)
+{
+    FlowConfig& flow = flows[flowIndex];
+    Ptr<Socket> socket = DynamicCast<BulkSendApplication>(flow.app)->GetSocket();
+    Ptr<TcpSocketBase> tcpSocket = DynamicCast<TcpSocketBase>(socket);
+    NS_ASSERT_MSG(tcpSocket, "Flow " << flowIndex << " has no TCP socket");
+
+    tcpSocket->SetEnableAbe(flow.abe);
+
+    tcpSocket->TraceConnectWithoutContext("AbeReduction",
+                                          MakeBoundCallback(&ReductionTracer, flowIndex));
+    tcpSocket->TraceConnectWithoutContext("LossReduction",
+                                          MakeBoundCallback(&ReductionTracer, flowIndex));
+
+    flow.tcb = tcpSocket->GetSocketState();
+    if (cwndSampler)
+    {
+        cwndSampler->Attach(flowIndex, tcpSocket);
+    }
+}
+
+/**
+* @brief Apply the parameters of a snapshot branch to the running simulation.
+*
+* A key starting with "/" is a Config path and is set with Config::Set, e.g.
+* a RED attribute of a bottleneck queue. Any other key is an attribute of the
+* congestion control or of the TcpSocketState of a flow (e.g. BetaEcn,
+* AbeAdaptive), and is set on every flow that has it.
+*
+* @param branch The branch.
+*/
+void
+ApplyBranch(const SnapshotBranch& branch)
+{
+    for (const auto& [key, value] : branch.params)
+    {
+        if (key[0] == '/')
+        {
+            Config::Set(key, StringValue(value));
+            continue;
+        }
+        uint32_t applied = 0;
+        for (uint32_t i = 0; i < flows.size(); i++)
+        {
+            Ptr<Socket> socket = DynamicCast<BulkSendApplication>(flows[i].app)->GetSocket();
+            Ptr<TcpSocketBase> tcpSocket = DynamicCast<TcpSocketBase>(socket);
+            NS_ABORT_MSG_UNLESS(tcpSocket,
+                                "Flow " << i << " has not started at the snapshot time");
+            PointerValue congestionOps;
+            tcpSocket->GetAttribute("CongestionOps", congestionOps);
+            if (congestionOps.Get<TcpCongestionOps>()->SetAttributeFailSafe(key,
+                                                                            StringValue(value)) ||
+                tcpSocket->GetSocketState()->SetAttributeFailSafe(key, StringValue(value)))
+            {
+                applied++;
+            }
+        }
+        NS_ABORT_MSG_IF(applied == 0,
+                        "Branch " << branch.name << ": no flow has an attribute " << key);
+    }
+}
+
+/**
+* @brief Restart the run totals, so that a snapshot branch reports its results
+*        from the snapshot time on instead of diluting them with the warm-up.
+*
+* FlowMonitor restarts the throughput duration of a flow at its first packet
+* sent after the reset. The queue length average restarts with the first time
+* bin closed after the reset.
+*
+* @param monitor The flow monitor.
+* @param queueProbe The bottleneck queue probe.
+*/
+void
+ResetRunTotals(Ptr<FlowMonitor> monitor, QueueEventProbe& queueProbe)
+{
+    throughputSum = 0;
+    throughputSamples = 0;
+    for (OnlineSummary* summary :
+         {&queueDelayMs,
+          &queueSizePackets,
+          &cwndSegments,
+          &goodputMbps,
+          &workloadGoodputMbps,
+          &utilization})
+    {
+        summary->Clear();
+    }
+    for (FlowConfig& flow : flows)
+    {
+        flow.ecnReductions = 0;
+        flow.lossReductions = 0;
+    }
+    monitor->ResetAllStats();
+    queueProbe.ResetTotals();
+}
+
+/**
+* @brief Open the trace files in the output directory.
+* @param binaryTraces Write binary columnar files instead of text.
+* @param multiFlow Prefix the per-flow samples with the flow id.
+* @param cwndFlowIds Prefix the cwnd samples with the flow id.
+*/
+void
+OpenTraceFiles(bool binaryTraces, bool multiFlow, bool cwndFlowIds)
+{
+    std::string traceExt = binaryTraces ? ".bin" : ".dat";
+    throughputFile.Open(dir + "/throughput" + traceExt, binaryTraces, TRACE_TIME_NS3, multiFlow);
+    goodputFile.Open(dir + "/goodput" + traceExt, binaryTraces, TRACE_TIME_NS3, multiFlow);
+    queueSizeFile.Open(dir + "/queueSize" + traceExt, binaryTraces, TRACE_TIME_SECONDS);
+    cwndFile.Open(dir + "/cwnd" + traceExt, binaryTraces, TRACE_TIME_SECONDS, cwndFlowIds);
+    queueEventsFile = fopen((dir + "/queueEvents.csv").c_str(), "w");
+    NS_ASSERT_MSG(throughputFile.IsOpen(), "Throughput file was not opened correctly");
+    NS_ASSERT_MSG(goodputFile.IsOpen(), "Goodput file was not opened correctly");
+    NS_ASSERT_MSG(queueSizeFile.IsOpen(), "Queue size file was not opened correctly");
+    NS_ASSERT_MSG(cwndFile.IsOpen(), "Cwnd file was not opened correctly");
+    NS_ASSERT_MSG(queueEventsFile, "Queue events file was not opened correctly");
+    setvbuf(queueEventsFile, nullptr, _IOFBF, 1 << 16);
+    fprintf(queueEventsFile, "time,avgPackets,maxPackets,enqueues,marks,earlyDrops,forcedDrops\n");
+}
+
+/**
+* @brief Close the trace files, writing any buffered samples.
+*/
+void
+CloseTraceFiles()
+{
+    throughputFile.Close();
+    goodputFile.Close();
+    queueSizeFile.Close();
+    cwndFile.Close();
+    if (queueEventsFile)
+    {
+        fclose(queueEventsFile);
+        queueEventsFile = nullptr;
+    }
+}
+
+/**
+* @brief Write the sojourn time histogram of the bottleneck queue.
+*
+* One line per non-empty bin: lower edge of the bin in ms and packet count.
+* The last bin, if not empty, counts every sojourn time from sojournMax on.
+*
+* @param probe The queue probe.
+* @param resolution Width of a histogram bin.
+*/
+void
+WriteSojournHistogram(const QueueEventProbe& probe, Time resolution)
+{
+    std::ofstream out(dir + "sojourn.csv", std::ios::out);
+    out << "sojournMs,packets\n";
+    const std::vector<uint64_t>& histogram = probe.GetSojournHistogram();
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        if (histogram[i] > 0)
+        {
+            out << (resolution * static_cast<int64_t>(i)).ToDouble(Time::MS) << ","
+                << histogram[i] << "\n";
+        }
+    }
+}
+
+/**
+* @brief Compute per-flow throughput and delay from FlowMonitor and log them.
+*
+* Writes one line per data flow to flows.csv, and the aggregate metrics (Jain's
+* fairness index, throughput per flow class, delay percentiles, window
+* reductions by cause) to config.
+*
+* @param monitor The FlowMonitor instance.
+* @param classifier The classifier of the FlowMonitor.
+* @param senderAddresses Address of every sender node, indexed by sender.
+* @param port Destination port of the data flows.
+* @param bottleneckMbps Rate of one bottleneck link in Mbps.
+* @param config The config.txt stream.
+*/
+void
+WriteFlowStats(Ptr<FlowMonitor> monitor,
+               Ptr<Ipv4FlowClassifier> classifier,
+               const std::vector<Ipv4Address>& senderAddresses,
+               uint16_t port,
+               double bottleneckMbps,
+               std::ostream& config)
+{
+    std::map<Ipv4Address, uint32_t> flowBySender;
+    for (uint32_t i = 0; i < flows.size(); i++)
+    {
+        flowBySender[senderAddresses[flows[i].sender]] = i;
+    }
+
+    std::ofstream flowFile(dir + "flows.csv", std::ios::out);
+    flowFile << "flow,tcpTypeId,abe,sender,receiver,hops,rxBytes,throughputMbps,meanDelayMs,"
+                "lostPackets,ecnReductions,lossReductions\n";
+
+    double sum = 0;
+    double sumSquares = 0;
+    double abeSum = 0;
+    double nonAbeSum = 0;
+    uint32_t count = 0;
+    uint32_t abeCount = 0;
+    std::vector<uint64_t> delayBins;
+    double delayBinWidth = 0;
+
+    monitor->CheckForLostPackets();
+    for (const auto& [flowId, st] : monitor->GetFlowStats())
+    {
+        Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(flowId);
+        auto it = flowBySender.find(t.sourceAddress);
+        if (t.destinationPort != port || it == flowBySender.end())
+        {
+            continue; // ACK direction or unrelated traffic
+        }
+        const FlowConfig& flow = flows[it->second];
+        double duration = (st.timeLastRxPacket - st.timeFirstTxPacket).GetSeconds();
+        double throughput = duration > 0 ? st.rxBytes * 8.0 / duration / 1e6 : 0;
+        double meanDelay = st.rxPackets ? st.delaySum.GetSeconds() * 1e3 / st.rxPackets : 0;
+        flowFile << it->second << "," << flow.tcpTypeId << "," << flow.abe << "," << flow.sender
+                 << "," << flow.receiver << "," << flow.hops << "," << st.rxBytes << ","
+                 << throughput << "," << meanDelay << "," << st.lostPackets << ","
+                 << flow.ecnReductions << "," << flow.lossReductions << "\n";
+
+        sum += throughput;
+        sumSquares += throughput * throughput;
+        count++;
+        (flow.abe ? abeSum : nonAbeSum) += throughput;
+        abeCount += flow.abe;
+
+        // All delay histograms share the FlowMonitor DelayBinWidth
+        if (delayBins.size() < st.delayHistogram.GetNBins())
+        {
+            delayBins.resize(st.delayHistogram.GetNBins(), 0);
+        }
+        for (uint32_t b = 0; b < st.delayHistogram.GetNBins(); b++)
+        {
+            delayBins[b] += st.delayHistogram.GetBinCount(b);
+            delayBinWidth = st.delayHistogram.GetBinWidth(b);
+        }
+    }
+    flowFile.close();
+
+    uint64_t delaySamples = std::accumulate(delayBins.begin(), delayBins.end(), uint64_t(0));
+    auto delayPercentile = [&](double q) {
+        uint64_t seen = 0;
+        for (size_t b = 0; b < delayBins.size(); b++)
+        {
+            seen += delayBins[b];
+            if (seen >= q * delaySamples)
+            {
+                return (b + 1) * delayBinWidth * 1e3;
+            }
+        }
+        return 0.0;
+    };
+
+    config << "dataFlows " << count << "\n";
+    config << "aggregateThroughput " << sum << "\n";
+    config << "linkUtilization " << sum / bottleneckMbps << "\n";
+    config << "jainIndex " << (sumSquares > 0 ? sum * sum / (count * sumSquares) : 0.0) << "\n";
+    config << "avgThroughputAbe " << (abeCount ? abeSum / abeCount : 0.0) << "\n";
+    config << "avgThroughputNonAbe "
+           << (count > abeCount ? nonAbeSum / (count - abeCount) : 0.0) << "\n";
+    config << "delayP50Ms " << delayPercentile(0.5) << "\n";
+    config << "delayP90Ms " << delayPercentile(0.9) << "\n";
+    config << "delayP99Ms " << delayPercentile(0.99) << "\n";
+
+    uint32_t ecnReductions = 0;
+    uint32_t lossReductions = 0;
+    for (const FlowConfig& flow : flows)
+    {
+        ecnReductions += flow.ecnReductions;
+        lossReductions += flow.lossReductions;
+    }
+    config << "ecnReductions " << ecnReductions << "\n";
+    config << "lossReductions " << lossReductions << "\n";
+}
+
+/**
+* @brief Write the flow completion times of the workload.
+*
+* fct.csv lists every workload flow, fctSummary.csv the FCT statistics per flow
+* size bucket and ABE setting. config.txt gets the totals and the percentiles of
+* all flows and of every bucket, ABE and non-ABE flows together. The summaries
+* only count the flows started at or after a given time.
+*
+* @param workload The workload generator.
+* @param edges Upper size limits of every bucket but the last, in bytes.
+* @param from Start of the summarized flows, e.g. the snapshot time of a branch.
+* @param config Stream the summary values are appended to.
+*/
+void
+WriteFctStats(const WorkloadGenerator& workload,
+              const std::vector<uint64_t>& edges,
+              Time from,
+              std::ostream& config)
+{
+    const std::vector<WorkloadGenerator::FlowRecord>& records = workload.GetFlows();
+    std::vector<WorkloadGenerator::FlowRecord> summarized;
+    std::copy_if(records.begin(),
+                 records.end(),
+                 std::back_inserter(summarized),
+                 [from](const WorkloadGenerator::FlowRecord& r) { return r.start >= from; });
+    std::ofstream fctFile(dir + "fct.csv", std::ios::out);
+    fctFile << "flow,sender,abe,sizeBytes,startS,failed,fctMs\n";
+    for (uint32_t f = 0; f < records.size(); f++)
+    {
+        const WorkloadGenerator::FlowRecord& r = records[f];
+        fctFile << f << "," << r.sender << "," << r.abe << "," << r.size << ","
+                << r.start.GetSeconds() << "," << r.failed << ",";
+        if (r.end.IsStrictlyPositive())
+        {
+            fctFile << (r.end - r.start).ToDouble(Time::MS);
+        }
+        fctFile << "\n";
+    }
+    fctFile.close();
+
+    std::ofstream summaryFile(dir + "fctSummary.csv", std::ios::out);
+    summaryFile << "minBytes,maxBytes,abe,flows,completed,failed,fctMsMean,fctMsP50,fctMsP99\n";
+    for (const FctBucket& b : SummarizeFct(summarized, edges))
+    {
+        summaryFile << b.lower << "," << b.upper << "," << b.abe << "," << b.flows << ","
+                    << b.completed << "," << b.failed << "," << b.meanMs << "," << b.p50Ms
+                    << "," << b.p99Ms << "\n";
+    }
+    summaryFile.close();
+
+    std::vector<FctBucket> all = SummarizeFct(summarized, {}, false);
+    FctBucket total = all.empty() ? FctBucket{} : all[0];
+    config << "workloadFlows " << total.flows << "\n";
+    config << "workloadCompleted " << total.completed << "\n";
+    config << "workloadFailed " << total.failed << "\n";
+    config << "workloadConnections " << workload.GetConnections() << "\n";
+    config << "workloadFailedConnections " << workload.GetFailedConnections() << "\n";
+    config << "fctMsMean " << total.meanMs << "\n";
+    config << "fctMsP50 " << total.p50Ms << "\n";
+    config << "fctMsP99 " << total.p99Ms << "\n";
+    // Buckets are named by their upper limit, the last one by its lower limit
+    for (const FctBucket& b : SummarizeFct(summarized, edges, false))
+    {
+        std::string name = b.upper ? "fct" + std::to_string(b.upper)
+                                   : "fct" + std::to_string(b.lower) + "Plus";
+        config << name << "MsP50 " << b.p50Ms << "\n";
+        config << name << "MsP99 " << b.p99Ms << "\n";
+    }
+}
+
+/**
+* @brief Write the profile of the run.
+*
+* profile.csv lists every event type and profiled trace sink with its calls and
+* wall-clock time, the most expensive first. The time of a sink is also part of
+* the time of the event that fired it. config.txt gets the wall-clock times,
+* the event rate and the memory figures.
+*
+* @param setupSeconds Wall-clock time from start-up to the first event.
+* @param runSeconds Wall-clock time of the event loop.
+* @param flowMonitorBytes Estimated memory of the FlowMonitor state.
+* @param queueProbe Backlog of all queue discs.
+* @param config Stream the summary values are appended to.
+*/
+void
+WriteProfile(double setupSeconds,
+             double runSeconds,
+             uint64_t flowMonitorBytes,
+             const QueueDiscMemoryProbe& queueProbe,
+             std::ostream& config)
+{
+    std::vector<std::pair<std::string, const ProfileEntry*>> entries;
+    double eventSeconds = 0;
+    for (const ProfileEntry& e : profiler->GetEvents())
+    {
+        entries.emplace_back("event", &e);
+        eventSeconds += e.nanoseconds / 1e9;
+    }
+    for (const ProfileEntry& e : profiler->GetSinks())
+    {
+        entries.emplace_back("sink", &e);
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.second->nanoseconds > b.second->nanoseconds;
+    });
+
+    std::ofstream profileFile(dir + "profile.csv", std::ios::out);
+    profileFile << "kind,name,calls,wallSeconds,runShare,nsPerCall\n";
+    for (const auto& [kind, e] : entries)
+    {
+        // Event type names hold commas, quotes are doubled for CSV
+        std::string name = e->name;
+        for (size_t q = name.find('"'); q != std::string::npos; q = name.find('"', q + 2))
+        {
+            name.insert(q, "\"");
+        }
+        profileFile << kind << ",\"" << name << "\"," << e->count << ","
+                    << e->nanoseconds / 1e9 << ","
+                    << (runSeconds > 0 ? e->nanoseconds / 1e9 / runSeconds : 0.0) << ","
+                    << (e->count ? static_cast<double>(e->nanoseconds) / e->count : 0.0) << "\n";
+    }
+    profileFile.close();
+
+    uint64_t events = Simulator::GetEventCount();
+    config << "profileSetupSeconds " << setupSeconds << "\n";
+    config << "profileRunSeconds " << runSeconds << "\n";
+    config << "profileEventSeconds " << eventSeconds << "\n";
+    config << "profileEvents " << events << "\n";
+    config << "profileEventTypes " << profiler->GetEvents().size() << "\n";
+    config << "eventsPerWallSecond " << (runSeconds > 0 ? events / runSeconds : 0.0) << "\n";
+    config << "peakRssMB " << PeakRss() / 1048576.0 << "\n";
+    config << "flowMonitorMB " << flowMonitorBytes / 1048576.0 << "\n";
+    config << "queueDiscPeakPackets " << queueProbe.GetPeakPackets() << "\n";
+    config << "queueDiscMB " << queueProbe.GetPeakMemory() / 1048576.0 << "\n";
+}
+
+/**
+* @brief Logical process of a router in a distributed run.
+*
+* Senders run on the first rank and receivers on the last one. The router
+* chain is split into contiguous segments over the ranks in between, so that
+* every rank boundary is crossed by a 5 ms edge link or a 10 ms bottleneck link.
+*
+* @param k Index of the router in the chain.
+* @param nRouters Number of routers.
+* @param nRanks Number of logical processes.
+* @return The rank of the router.
+*/
+uint32_t
+RouterRank(uint32_t k, uint32_t nRouters, uint32_t nRanks)
+{
+    if (nRanks <= 2)
+    {
+        return 0;
+    }
+    return 1 + k * (nRanks - 2) / nRouters;
+}
+
+/**
+* @brief Per-flow goodput and fairness of a distributed run.
+*
+* FlowMonitor needs both ends of a flow in one process, so distributed runs
+* report the goodput counted at the sinks instead, summed over all ranks.
+* Writes one line per flow to flows.csv and the aggregate metrics to config.
+*
+* @param resultDir Directory of flows.csv.
+* @param rxBytes Application bytes received per flow.
+* @param stopTime Stop time of the applications.
+* @param bottleneckMbps Rate of one bottleneck link in Mbps.
+* @param config The config.txt stream.
+*/
+void
+WriteDistributedFlowStats(const std::string& resultDir,
+                          const std::vector<uint64_t>& rxBytes,
+                          Time stopTime,
+                          double bottleneckMbps,
+                          std::ostream& config)
 {
-    *stream->GetStream() << Simulator::Now().GetSeconds() << " " << newval / 1448.0 << std::endl;
+    std::ofstream flowFile(resultDir + "flows.csv", std::ios::out);
+    flowFile << "flow,tcpTypeId,abe,sender,receiver,hops,rxBytes,goodputMbps,ecnReductions,"
+                "lossReductions\n";
+
+    double sum = 0;
+    double sumSquares = 0;
+    uint32_t ecnReductions = 0;
+    uint32_t lossReductions = 0;
+    for (uint32_t i = 0; i < flows.size(); i++)
+    {
+        const FlowConfig& flow = flows[i];
+        double duration = (stopTime - flow.start).GetSeconds();
+        double goodput = duration > 0 ? rxBytes[i] * 8.0 / duration / 1e6 : 0;
+        flowFile << i << "," << flow.tcpTypeId << "," << flow.abe << "," << flow.sender << ","
+                 << flow.receiver << "," << flow.hops << "," << rxBytes[i] << "," << goodput
+                 << "," << flow.ecnReductions << "," << flow.lossReductions << "\n";
+        sum += goodput;
+        sumSquares += goodput * goodput;
+        ecnReductions += flow.ecnReductions;
+        lossReductions += flow.lossReductions;
+    }
+    flowFile.close();
+
+    config << "dataFlows " << flows.size() << "\n";
+    config << "aggregateGoodput " << sum << "\n";
+    config << "goodputUtilization " << sum / bottleneckMbps << "\n";
+    config << "goodputJainIndex "
+           << (sumSquares > 0 ? sum * sum / (flows.size() * sumSquares) : 0.0) << "\n";
+    config << "ecnReductions " << ecnReductions << "\n";
+    config << "lossReductions " << lossReductions << "\n";
 }
 
+#ifdef NS3_MPI
 /**
-* @brief Set up CWND tracing for a specific node and socket.
-* @param nodeId The node ID.
-* @param socketId The socket ID.
+* @brief Sum the results kept by every rank of a distributed run on rank 0.
+*
+* Only rank 0 holds valid sums afterwards.
+*
+* @param probe The per-flow byte counters of this rank.
+* @param rxBytes Set to the application bytes received per flow.
+* @param queue The queue totals of this rank, set to those of the queue's rank.
 */
 void
-TraceCwnd(uint32_t nodeId, uint32_t socketId)
+ReduceDistributedStats(const FlowDeltaProbe& probe,
+                       std::vector<uint64_t>& rxBytes,
+                       QueueTotals& queue)
 {
-    AsciiTraceHelper ascii;
-    Ptr<OutputStreamWrapper> stream = ascii.CreateFileStream(dir + "/cwnd.dat");
-    Config::ConnectWithoutContext("/NodeList/" + std::to_string(nodeId) +
-                                    "/$ns3::TcpL4Protocol/SocketList/" +
-                                    std::to_string(socketId) + "/CongestionWindow",
-                                MakeBoundCallback(&CwndTracer, stream));
+    std::vector<uint64_t> local(flows.size());
+    for (uint32_t i = 0; i < flows.size(); i++)
+    {
+        local[i] = probe.GetRxBytes(i);
+    }
+    rxBytes.assign(flows.size(), 0);
+    MPI_Reduce(local.data(),
+               rxBytes.data(),
+               flows.size(),
+               MPI_UINT64_T,
+               MPI_SUM,
+               0,
+               MPI_COMM_WORLD);
+
+    // The queue is instrumented by the rank of its router only, the others add zeros
+    QueueTotals total;
+    MPI_Reduce(&queue,
+               &total,
+               sizeof(QueueTotals) / sizeof(double),
+               MPI_DOUBLE,
+               MPI_SUM,
+               0,
+               MPI_COMM_WORLD);
+    queue = total;
+}
+#endif
+
+/**
+* @return The online summaries with their names, in output order.
+*/
+std::vector<std::pair<std::string, const OnlineSummary*>>
+OnlineSummaries()
+{
+    return {{"queueDelayMs", &queueDelayMs},
+            {"queueSizePackets", &queueSizePackets},
+            {"cwndSegments", &cwndSegments},
+            {"goodputMbps", &goodputMbps},
+            {"workloadGoodputMbps", &workloadGoodputMbps},
+            {"utilization", &utilization}};
+}
+
+/**
+* @brief Add the online summaries to config.txt, as <metric>Mean, <metric>P50 and
+*        <metric>P99 lines that sweeps can collect.
+* @param config The config.txt stream.
+*/
+void
+WriteOnlineStats(std::ostream& config)
+{
+    for (const auto& [name, summary] : OnlineSummaries())
+    {
+        config << name << "Mean " << summary->GetStats().GetMean() << "\n";
+        config << name << "P50 " << summary->GetQuantile(0.5) << "\n";
+        config << name << "P99 " << summary->GetQuantile(0.99) << "\n";
+    }
+}
+
+/**
+* @brief Split config.txt lines into key and value at the last space.
+* @param text The config.txt content.
+* @return The key/value pairs, in order.
+*/
+std::vector<std::pair<std::string, std::string>>
+ParseConfig(const std::string& text)
+{
+    std::vector<std::pair<std::string, std::string>> entries;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t space = line.find_last_of(' ');
+        if (space != std::string::npos)
+        {
+            entries.emplace_back(line.substr(0, space), line.substr(space + 1));
+        }
+    }
+    return entries;
+}
+
+/**
+* @brief Collect the results of the replicas of a run.
+*
+* Writes replicas.csv (one line per replica with its directory and metrics)
+* and confidence.csv (mean and 95% confidence interval of every metric over
+* the replicas that finished) to the root directory, and prints the intervals.
+*
+* @param root The root directory of the replicas.
+* @param replicas The replicas, named by their run number.
+* @param replicaDirs The output directory of every replica, relative to root.
+* @param metrics The config.txt keys to summarize.
+* @return The number of replicas that failed.
+*/
+uint32_t
+SummarizeReplicas(const std::string& root,
+                  const std::vector<SnapshotBranch>& replicas,
+                  const std::vector<std::string>& replicaDirs,
+                  const std::vector<std::string>& metrics)
+{
+    std::vector<OnlineStats> stats(metrics.size());
+    std::ofstream table(root + "replicas.csv", std::ios::out);
+    table << "run,status,dir";
+    for (const std::string& metric : metrics)
+    {
+        table << "," << metric;
+    }
+    table << "\n";
+    uint32_t failed = 0;
+    for (size_t r = 0; r < replicas.size(); r++)
+    {
+        table << replicas[r].name << "," << replicas[r].status << "," << replicaDirs[r];
+        std::ifstream configFile(root + replicaDirs[r] + "/config.txt");
+        std::stringstream text;
+        text << configFile.rdbuf();
+        std::map<std::string, std::string> config;
+        for (const auto& [key, value] : ParseConfig(text.str()))
+        {
+            config[key] = value;
+        }
+        for (size_t m = 0; m < metrics.size(); m++)
+        {
+            auto it = config.find(metrics[m]);
+            table << "," << (it != config.end() ? it->second : "");
+            char* end = nullptr;
+            double value = it != config.end() ? strtod(it->second.c_str(), &end) : 0;
+            if (replicas[r].status == 0 && end && end != it->second.c_str())
+            {
+                stats[m].Add(value);
+            }
+        }
+        table << "\n";
+        failed += (replicas[r].status != 0);
+    }
+
+    std::ofstream ciFile(root + "confidence.csv", std::ios::out);
+    ciFile << "metric,replicas,mean,stddev,ci95Low,ci95High\n";
+    std::cout << "95% confidence intervals over " << replicas.size() - failed << " replicas:\n";
+    for (size_t m = 0; m < metrics.size(); m++)
+    {
+        ConfidenceInterval ci = ConfidenceInterval95(stats[m]);
+        ciFile << metrics[m] << "," << ci.count << "," << ci.mean << "," << stats[m].GetStddev()
+               << "," << ci.mean - ci.halfWidth << "," << ci.mean + ci.halfWidth << "\n";
+        std::cout << "  " << metrics[m] << " " << ci.mean << " +- " << ci.halfWidth << "\n";
+    }
+    if (failed > 0)
+    {
+        std::cout << failed << " replicas failed, see " << root << "replicas.csv\n";
+    }
+    return failed;
 }
 
 /**
@@ -117,7 +960,9 @@ main(int argc, char* argv[])
 {
     // Default configuration values
     std::string tcpTypeId = "TcpCubic";
-    std::string queueDisc = "RedQueueDisc";
+    std::string aqm = "red";
+    Time aqmTarget = Seconds(0);
+    Time aqmInterval = Seconds(0);
     uint32_t dataSize = 1448;
     uint32_t delAckCount = 2;
     bool bql = true;
@@ -128,6 +973,40 @@ main(int argc, char* argv[])
     double maxTh = 50.0;
     bool AdaptMaxP = false;
     bool useEcn = true;
+    std::string outputDir = "";
+    std::string runs = "";
+    uint32_t runJobs = sysconf(_SC_NPROCESSORS_ONLN);
+    std::string ciMetrics = "avgThroughput,goodputMbpsMean,queueDelayMsMean,queueDelayMsP99";
+    std::string traceFormat = "text";
+    uint32_t nSenders = 1;
+    uint32_t nReceivers = 1;
+    uint32_t nBottlenecks = 1;
+    double abeFraction = 1.0;
+    std::string altTcpTypeId = "TcpLinuxReno";
+    double altTcpFraction = 0.0;
+    Time startSpread = Seconds(0);
+    Time throughputInterval = MilliSeconds(200);
+    std::string cwndFlows = "0";
+    CwndSampler::Options cwndOptions;
+    bool abeAdaptive = false;
+    bool accEcn = false;
+    std::string workloadCdf = "";
+    WorkloadGenerator::Options workloadOptions;
+    std::string fctBuckets = "10000,100000,1000000";
+    bool bulkFlows = true;
+    bool profile = false;
+    std::string bottleneckBandwidth = "10Mbps";
+    Time bottleneckDelay = MilliSeconds(10);
+    Time snapshotTime = Seconds(0);
+    std::string branchFile = "";
+    uint32_t branchJobs = sysconf(_SC_NPROCESSORS_ONLN);
+    std::string pcapMode = "full";
+    PcapRing::Options pcapOptions;
+    Time pcapStop = Seconds(0);
+    uint32_t pcapMaxFileMB = 64;
+    bool distributed = false;
+    bool nullMsg = false;
+    QueueEventProbe::Options queueOptions;
 
     // Parse command-line arguments
     CommandLine cmd(__FILE__);
@@ -140,10 +1019,207 @@ main(int argc, char* argv[])
     cmd.AddValue("maxTh", "Maximum threshold for RED", maxTh);
     cmd.AddValue("AdaptMaxP", "Enable adaptive max probability for RED", AdaptMaxP);
     cmd.AddValue("QW", "Weight for queue size for RED", qW);
+    cmd.AddValue("aqm", "Bottleneck AQM: red, codel, fqcodel, pie or fqpie", aqm);
+    cmd.AddValue("aqmTarget", "CoDel target or PIE delay reference (0 = preset default)",
+                 aqmTarget);
+    cmd.AddValue("aqmInterval", "CoDel interval (0 = preset default)", aqmInterval);
+    cmd.AddValue("outputDir", "Output directory (default: cubic-results/<config hash>)", outputDir);
+    cmd.AddValue("runs", "Replicas as a range of RngRun values, e.g. 1..10 (empty = one run)",
+                 runs);
+    cmd.AddValue("runJobs", "Number of replicas running in parallel", runJobs);
+    cmd.AddValue("ciMetrics", "config.txt keys given with confidence intervals over the replicas",
+                 ciMetrics);
+    cmd.AddValue("traceFormat", "Trace file format: text (.dat) or binary (.bin)", traceFormat);
+    cmd.AddValue("nSenders", "Number of sender nodes, one bulk flow each", nSenders);
+    cmd.AddValue("nReceivers", "Number of receiver nodes", nReceivers);
+    cmd.AddValue("nBottlenecks", "Number of bottleneck links in the parking lot", nBottlenecks);
+    cmd.AddValue("bottleneckBandwidth", "Rate of every bottleneck link", bottleneckBandwidth);
+    cmd.AddValue("bottleneckDelay", "Delay of every bottleneck link", bottleneckDelay);
+    cmd.AddValue("abeFraction", "Fraction of flows backing off by BetaEcn on ECN marks", abeFraction);
+    cmd.AddValue("altTcpTypeId", "Congestion control of the alternative flows", altTcpTypeId);
+    cmd.AddValue("altTcpFraction", "Fraction of flows using altTcpTypeId", altTcpFraction);
+    cmd.AddValue("startSpread", "Flow start times are spread evenly over this interval", startSpread);
+    cmd.AddValue("throughputInterval", "Sampling interval of throughput/goodput", throughputInterval);
+    cmd.AddValue("cwndFlows",
+                 "Flows whose cwnd is traced: all, none, or ids and ranges, e.g. 0,5..9",
+                 cwndFlows);
+    cmd.AddValue("cwndInterval", "Shortest time between two cwnd samples of a flow (0 = any)",
+                 cwndOptions.interval);
+    cmd.AddValue("cwndThreshold", "Smallest logged cwnd change of a flow, in segments",
+                 cwndOptions.threshold);
+    cmd.AddValue("abeAdaptive", "Pick BetaEcn per flow from the observed marking rate", abeAdaptive);
+    cmd.AddValue("accEcn", "Receivers feed back CE-marked byte counts (AccECN option)", accEcn);
+    cmd.AddValue("workload", "Flow size CDF file of the short-flow workload (empty = none)",
+                 workloadCdf);
+    cmd.AddValue("workloadLoad", "Offered load of the workload, fraction of the bottleneck rate",
+                 workloadOptions.load);
+    cmd.AddValue("workloadPool", "Largest number of workload connections per sender",
+                 workloadOptions.poolSize);
+    cmd.AddValue("fctBuckets", "Upper flow sizes in bytes of the FCT buckets but the last",
+                 fctBuckets);
+    cmd.AddValue("bulkFlows", "Run one bulk flow per sender", bulkFlows);
+    cmd.AddValue("profile", "Profile wall-clock time per event type and memory (profile.csv)",
+                 profile);
+    cmd.AddValue("snapshotTime", "Fork the branches at this time (0 = no snapshot)", snapshotTime);
+    cmd.AddValue("branches", "Branch file, one parameter set per branch", branchFile);
+    cmd.AddValue("branchJobs", "Number of branches running in parallel", branchJobs);
+    cmd.AddValue("pcapMode", "Pcap capture: full (every packet, whole run) or ring", pcapMode);
+    cmd.AddValue("pcapSnaplen", "Bytes kept per packet in ring mode", pcapOptions.snaplen);
+    cmd.AddValue("pcapStart", "Start of the capture window in ring mode", pcapOptions.start);
+    cmd.AddValue("pcapStop", "End of the capture window in ring mode (0 = end of run)", pcapStop);
+    cmd.AddValue("pcapEcnOnly", "Capture only CE-marked and ECE packets in ring mode",
+                 pcapOptions.ecnOnly);
+    cmd.AddValue("pcapMaxFiles", "Ring files per device (0 = never overwrite)", pcapOptions.maxFiles);
+    cmd.AddValue("pcapMaxFileMB", "Size in MB at which a ring file is rotated", pcapMaxFileMB);
+    cmd.AddValue("distributed", "Run senders, routers and receivers as MPI logical processes",
+                 distributed);
+    cmd.AddValue("nullMsg", "Use null message synchronization in distributed runs", nullMsg);
+    cmd.AddValue("queueBin", "Time bin of the bottleneck queue instrumentation",
+                 queueOptions.binInterval);
+    cmd.AddValue("sojournResolution", "Bin width of the sojourn time histogram",
+                 queueOptions.sojournResolution);
+    cmd.AddValue("sojournMax", "Largest sojourn time resolved by the histogram",
+                 queueOptions.sojournMax);
     cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(traceFormat != "text" && traceFormat != "binary",
+                    "traceFormat must be text or binary");
+    NS_ABORT_MSG_IF(nSenders == 0 || nReceivers == 0 || nBottlenecks == 0,
+                    "nSenders, nReceivers and nBottlenecks must be at least 1");
+    NS_ABORT_MSG_IF(pcapMode != "full" && pcapMode != "ring", "pcapMode must be full or ring");
+    bottleneckRateMbps = DataRate(bottleneckBandwidth).GetBitRate() / 1e6;
+    if (pcapStop.IsStrictlyPositive())
+    {
+        pcapOptions.stop = pcapStop;
+    }
+    pcapOptions.maxFileBytes = static_cast<uint64_t>(pcapMaxFileMB) << 20;
+    bool pcapRing = enablePcap && pcapMode == "ring";
 
-    // Configure TCP and RED parameters
-    queueDisc = "ns3::" + queueDisc;
+    bool workload = !workloadCdf.empty();
+    FlowSizeCdf flowSizes;
+    std::vector<uint64_t> fctEdges;
+    if (workload)
+    {
+        NS_ABORT_MSG_UNLESS(flowSizes.Load(workloadCdf),
+                            "Cannot read flow size CDF " << workloadCdf);
+        NS_ABORT_MSG_IF(distributed, "The workload cannot be used in distributed runs");
+        std::istringstream edgeList(fctBuckets);
+        std::string edge;
+        while (std::getline(edgeList, edge, ','))
+        {
+            fctEdges.push_back(std::stoull(edge));
+            NS_ABORT_MSG_IF(fctEdges.back() == 0 ||
+                                (fctEdges.size() > 1 &&
+                                 fctEdges.back() <= fctEdges[fctEdges.size() - 2]),
+                            "fctBuckets must be increasing positive sizes, got " << fctBuckets);
+        }
+    }
+    NS_ABORT_MSG_IF(!bulkFlows && !workload, "Without bulkFlows, a workload is needed");
+
+    bool snapshot = snapshotTime.IsStrictlyPositive();
+    std::vector<SnapshotBranch> branches;
+    if (snapshot)
+    {
+        NS_ABORT_MSG_IF(snapshotTime >= stopTime, "snapshotTime must be before stopTime");
+        NS_ABORT_MSG_IF(!bulkFlows, "Snapshot branches apply to the bulk flows");
+        NS_ABORT_MSG_IF(enablePcap && !pcapRing,
+                        "Full pcap files cannot be shared by branches, use --pcapMode=ring");
+        std::string error;
+        branches = ReadBranches(branchFile, error);
+        NS_ABORT_MSG_IF(branches.empty(), "Cannot read branches: " << error);
+    }
+
+    // Output directories are named by a hash of the configuration, RNG seed and run.
+    // With a range of runs, fork one replica per run number; the parent waits for
+    // all of them and writes the confidence intervals of their results.
+    std::vector<std::string> configArgs = ConfigArguments(
+        argc,
+        argv,
+        {"outputDir", "runs", "runJobs", "ciMetrics", "branchJobs", "RngSeed", "RngRun"});
+    uint32_t seed = RngSeedManager::GetSeed();
+    uint64_t run = RngSeedManager::GetRun();
+    std::string runDir = RunDirectoryName(configArgs, seed, run);
+    if (!runs.empty())
+    {
+        uint32_t firstRun;
+        uint32_t lastRun;
+        NS_ABORT_MSG_UNLESS(ParseRunRange(runs, firstRun, lastRun),
+                            "runs must be a run number or a range A..B, got " << runs);
+        NS_ABORT_MSG_IF(distributed, "Replicas cannot be used in distributed runs");
+        NS_ABORT_MSG_IF(snapshot, "Replicas cannot be combined with snapshot branches");
+        std::string root = outputDir;
+        if (root.empty())
+        {
+            root = "cubic-results/" + HashConfig(configArgs, "seed=" + std::to_string(seed));
+        }
+        root += "/";
+        MakeDirectories(root);
+        std::vector<SnapshotBranch> replicas;
+        std::vector<std::string> replicaDirs;
+        for (uint32_t r = firstRun; r <= lastRun; r++)
+        {
+            SnapshotBranch replica;
+            replica.name = std::to_string(r);
+            replicas.push_back(replica);
+            replicaDirs.push_back(RunDirectoryName(configArgs, seed, r));
+        }
+
+        int replica = ForkBranches(replicas, std::max(runJobs, 1U));
+        if (replica < 0)
+        {
+            std::vector<std::string> metrics;
+            std::istringstream metricList(ciMetrics);
+            std::string metric;
+            while (std::getline(metricList, metric, ','))
+            {
+                metrics.push_back(metric);
+            }
+            return SummarizeReplicas(root, replicas, replicaDirs, metrics) > 0 ? 1 : 0;
+        }
+        run = firstRun + replica;
+        RngSeedManager::SetRun(run);
+        runDir = replicaDirs[replica];
+        outputDir = root + runDir;
+    }
+
+    // In a distributed run every rank builds the whole topology, but only runs the
+    // nodes whose system id is its rank. The lookahead is the smallest delay of the
+    // links crossing ranks, 5 ms with the default partitioning.
+    uint32_t systemId = 0;
+    uint32_t systemCount = 1;
+    if (distributed)
+    {
+        NS_ABORT_MSG_IF(snapshot, "Snapshot branches cannot be used in distributed runs");
+#ifdef NS3_MPI
+        GlobalValue::Bind("SimulatorImplementationType",
+                          StringValue(nullMsg ? "ns3::NullMessageSimulatorImpl"
+                                              : "ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        systemId = MpiInterface::GetSystemId();
+        systemCount = MpiInterface::GetSize();
+#else
+        NS_FATAL_ERROR("distributed requires NS-3 to be built with --enable-mpi");
+#endif
+    }
+
+    // Profiling replaces the scheduler, before anything is scheduled
+    auto wallStart = std::chrono::steady_clock::now();
+    double runSeconds = 0;
+    if (profile)
+    {
+        NS_ABORT_MSG_IF(distributed, "Profiling cannot be used in distributed runs");
+        profiler = ProfilingSimulatorImpl::Enable();
+        for (const char* name : {"QueueBinTracer",
+                                 "CwndSampleTracer",
+                                 "SojournTracer",
+                                 "ReductionTracer",
+                                 "PcapRing",
+                                 "FlowMonitorProbes"})
+        {
+            profiler->AddSink(name);
+        }
+    }
+
+    // Configure TCP and AQM parameters
     Config::SetDefault("ns3::TcpL4Protocol::SocketType", StringValue("ns3::" + tcpTypeId));
     Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(4194304));
     Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(6291456));
@@ -151,38 +1227,55 @@ main(int argc, char* argv[])
     Config::SetDefault("ns3::TcpSocket::DelAckCount", UintegerValue(delAckCount));
     Config::SetDefault("ns3::TcpSocket::SegmentSize", UintegerValue(dataSize));
     Config::SetDefault("ns3::DropTailQueue<Packet>::MaxSize", QueueSizeValue(QueueSize("1p")));
-    Config::SetDefault("ns3::RedQueueDisc::ARED", BooleanValue(true));
-    Config::SetDefault("ns3::RedQueueDisc::Gentle", BooleanValue(true));
-    Config::SetDefault("ns3::RedQueueDisc::MinTh", DoubleValue(minTh));
-    Config::SetDefault("ns3::RedQueueDisc::MaxTh", DoubleValue(maxTh));
-    Config::SetDefault("ns3::RedQueueDisc::AdaptMaxP", BooleanValue(AdaptMaxP));
-    Config::SetDefault("ns3::RedQueueDisc::LinkBandwidth", StringValue("10Mbps"));
-    Config::SetDefault("ns3::RedQueueDisc::LinkDelay", StringValue("10ms"));
-    Config::SetDefault("ns3::RedQueueDisc::MeanPktSize", UintegerValue(500));
-    Config::SetDefault("ns3::RedQueueDisc::QW", DoubleValue(qW));
-    Config::SetDefault("ns3::RedQueueDisc::UseHardDrop", BooleanValue(false));
-    Config::SetDefault(queueDisc + "::MaxSize", QueueSizeValue(QueueSize("666p")));
-    Config::SetDefault("ns3::RedQueueDisc::UseEcn", BooleanValue(useEcn));
+    AqmSettings aqmSettings;
+    aqmSettings.useEcn = useEcn;
+    aqmSettings.minTh = minTh;
+    aqmSettings.maxTh = maxTh;
+    aqmSettings.qW = qW;
+    aqmSettings.adaptMaxP = AdaptMaxP;
+    aqmSettings.linkBandwidth = bottleneckBandwidth;
+    aqmSettings.linkDelay = bottleneckDelay;
+    aqmSettings.target = aqmTarget;
+    aqmSettings.interval = aqmInterval;
+    std::string queueDisc = ConfigureAqm(aqm, aqmSettings);
     Config::SetDefault("ns3::TcpSocketBase::UseEcn", EnumValue(TcpSocketState::On));
     Config::SetDefault("ns3::TcpSocketState::EnableAbe", BooleanValue(true));
+    Config::SetDefault("ns3::TcpSocketState::AbeAdaptive", BooleanValue(abeAdaptive));
+    Config::SetDefault("ns3::TcpSocketState::AccEcn", BooleanValue(accEcn));
 
     // Create nodes
     NodeContainer sender, receiver, routers;
-    sender.Create(1);
-    receiver.Create(1);
-    routers.Create(2);
+    sender.Create(nSenders, 0);
+    receiver.Create(nReceivers, systemCount - 1);
+    for (uint32_t k = 0; k < nBottlenecks + 1; k++)
+    {
+        routers.Create(1, RouterRank(k, nBottlenecks + 1, systemCount));
+    }
 
     // Create point-to-point links
     PointToPointHelper bottleneckLink, edgeLink;
-    bottleneckLink.SetDeviceAttribute("DataRate", StringValue("10Mbps"));
-    bottleneckLink.SetChannelAttribute("Delay", StringValue("10ms"));
+    bottleneckLink.SetDeviceAttribute("DataRate", StringValue(bottleneckBandwidth));
+    bottleneckLink.SetChannelAttribute("Delay", TimeValue(bottleneckDelay));
     edgeLink.SetDeviceAttribute("DataRate", StringValue("1000Mbps"));
     edgeLink.SetChannelAttribute("Delay", StringValue("5ms"));
 
-    // Install network devices
-    NetDeviceContainer senderEdge = edgeLink.Install(sender.Get(0), routers.Get(0));
-    NetDeviceContainer r1r2 = bottleneckLink.Install(routers.Get(0), routers.Get(1));
-    NetDeviceContainer receiverEdge = edgeLink.Install(routers.Get(1), receiver.Get(0));
+    // Install network devices. Sender i attaches to router i % nBottlenecks, so with
+    // several bottlenecks flows cross a different number of them (parking lot).
+    std::vector<NetDeviceContainer> senderEdges;
+    std::vector<NetDeviceContainer> bottlenecks;
+    std::vector<NetDeviceContainer> receiverEdges;
+    for (uint32_t i = 0; i < nSenders; i++)
+    {
+        senderEdges.push_back(edgeLink.Install(sender.Get(i), routers.Get(i % nBottlenecks)));
+    }
+    for (uint32_t k = 0; k < nBottlenecks; k++)
+    {
+        bottlenecks.push_back(bottleneckLink.Install(routers.Get(k), routers.Get(k + 1)));
+    }
+    for (uint32_t j = 0; j < nReceivers; j++)
+    {
+        receiverEdges.push_back(edgeLink.Install(routers.Get(nBottlenecks), receiver.Get(j)));
+    }
 
     // Install internet stack
     InternetStackHelper internet;
@@ -197,87 +1290,442 @@ main(int argc, char* argv[])
     {
         tch.SetQueueLimits("ns3::DynamicQueueLimits", "HoldTime", StringValue("1000ms"));
     }
-    tch.Install(senderEdge);
-    tch.Install(receiverEdge);
+    QueueDiscContainer edgeQd;
+    for (auto& edge : senderEdges)
+    {
+        edgeQd.Add(tch.Install(edge));
+    }
+    for (auto& edge : receiverEdges)
+    {
+        edgeQd.Add(tch.Install(edge));
+    }
 
     // Assign IP addresses
     Ipv4AddressHelper ipv4;
     ipv4.SetBase("10.0.0.0", "255.255.255.0");
-    Ipv4InterfaceContainer i1i2 = ipv4.Assign(r1r2);
-    ipv4.NewNetwork();
-    Ipv4InterfaceContainer is1 = ipv4.Assign(senderEdge);
-    ipv4.NewNetwork();
-    Ipv4InterfaceContainer ir1 = ipv4.Assign(receiverEdge);
+    for (auto& link : bottlenecks)
+    {
+        ipv4.Assign(link);
+        ipv4.NewNetwork();
+    }
+    std::vector<Ipv4Address> senderAddresses;
+    for (auto& edge : senderEdges)
+    {
+        senderAddresses.push_back(ipv4.Assign(edge).GetAddress(0));
+        ipv4.NewNetwork();
+    }
+    std::vector<Ipv4Address> receiverAddresses;
+    for (auto& edge : receiverEdges)
+    {
+        receiverAddresses.push_back(ipv4.Assign(edge).GetAddress(1));
+        ipv4.NewNetwork();
+    }
 
     // Populate routing tables
     Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 
-    // Install applications
+    // Install applications, one bulk flow per sender. ABE and alternative congestion
+    // control flows are interleaved so every class is spread over all bottlenecks.
+    // Workload connections of a sender use the same congestion control and ABE setting.
+    std::vector<bool> cwndTraced = ParseFlowSet(cwndFlows, nSenders);
+    CwndSampler cwndSampler(cwndOptions);
+    cwndSampler.SetSampleCallback(MakeCallback(&CwndSampleTracer));
     uint16_t port = 50001;
-    BulkSendHelper source("ns3::TcpSocketFactory", InetSocketAddress(ir1.GetAddress(1), port));
-    source.SetAttribute("MaxBytes", UintegerValue(0));
-    ApplicationContainer sourceApps = source.Install(sender.Get(0));
-    sourceApps.Start(Seconds(0.1));
-    Simulator::Schedule(Seconds(0.1) + MilliSeconds(1), &TraceCwnd, 0, 0);
-    sourceApps.Stop(stopTime);
+    for (uint32_t i = 0; i < nSenders; i++)
+    {
+        FlowConfig flow;
+        flow.sender = i;
+        flow.receiver = i % nReceivers;
+        flow.hops = nBottlenecks - i % nBottlenecks;
+        bool alt = std::floor((i + 1) * altTcpFraction) > std::floor(i * altTcpFraction);
+        flow.tcpTypeId = alt ? altTcpTypeId : tcpTypeId;
+        flow.abe = std::floor((i + 1) * abeFraction) > std::floor(i * abeFraction);
+        flow.start = Seconds(0.1) + startSpread * (static_cast<double>(i) / nSenders);
+        if (sender.Get(i)->GetSystemId() != systemId)
+        {
+            flows.push_back(flow);
+            continue;
+        }
+
+        sender.Get(i)->GetObject<TcpL4Protocol>()->SetAttribute(
+            "SocketType",
+            TypeIdValue(TypeId::LookupByName("ns3::" + flow.tcpTypeId)));
+        if (!bulkFlows)
+        {
+            flows.push_back(flow);
+            continue;
+        }
+        BulkSendHelper source("ns3::TcpSocketFactory",
+                              InetSocketAddress(receiverAddresses[flow.receiver], port));
+        source.SetAttribute("MaxBytes", UintegerValue(0));
+        flow.app = source.Install(sender.Get(i)).Get(0);
+        flow.app->SetStartTime(flow.start);
+        flow.app->SetStopTime(stopTime);
+        flows.push_back(flow);
+        Simulator::Schedule(flow.start + TimeStep(1),
+                            &SetupFlow,
+                            i,
+                            cwndTraced[i] ? &cwndSampler : nullptr);
+    }
 
     PacketSinkHelper sink("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
-    ApplicationContainer sinkApps = sink.Install(receiver.Get(0));
+    ApplicationContainer sinkApps;
+    for (uint32_t j = 0; j < nReceivers; j++)
+    {
+        if (receiver.Get(j)->GetSystemId() == systemId)
+        {
+            sinkApps.Add(sink.Install(receiver.Get(j)));
+        }
+    }
     sinkApps.Start(Seconds(0.0));
     sinkApps.Stop(stopTime);
 
+    // Count bytes per flow directly at the end hosts
+    FlowDeltaProbe probe(nSenders);
+    for (uint32_t i = 0; i < nSenders; i++)
+    {
+        probe.AttachSender(i, sender.Get(i), senderAddresses[i], port);
+    }
+    for (uint32_t j = 0; j < sinkApps.GetN(); j++)
+    {
+        probe.AttachSink(DynamicCast<PacketSink>(sinkApps.Get(j)));
+    }
+
     // Create output directory
-    time_t rawtime;
-    struct tm* timeinfo;
-    char buffer[80];
-    time(&rawtime);
-    timeinfo = localtime(&rawtime);
-    strftime(buffer, sizeof(buffer), "%d-%m-%Y-%I-%M-%S", timeinfo);
-    dir = "cubic-results/" + std::string(buffer) + "/";
+    if (outputDir.empty())
+    {
+        // Every rank of a distributed run has the same command line, hence directory
+        dir = "cubic-results/" + runDir + "/";
+    }
+    else
+    {
+        dir = outputDir + "/";
+    }
+    // Each rank of a distributed run writes the traces of its own nodes to rank-<id>/,
+    // rank 0 writes the results of the run to the output directory
+    std::string resultDir = dir;
+    if (distributed)
+    {
+        dir = resultDir + "rank-" + std::to_string(systemId) + "/";
+    }
     MakeDirectories(dir);
 
-    // Trace queue occupancy
-    tch.Uninstall(routers.Get(0)->GetDevice(1));
-    QueueDiscContainer qd = tch.Install(routers.Get(0)->GetDevice(1));
-    Simulator::ScheduleNow(&CheckQueueSize, qd.Get(0));
+    // Install the AQM on every bottleneck and instrument the last one. Senders are
+    // spread over the first routers but every receiver is behind the last one, so the
+    // last bottleneck is the only link that every flow crosses.
+    QueueDiscContainer qd;
+    for (auto& link : bottlenecks)
+    {
+        tch.Uninstall(link.Get(0));
+        qd.Add(tch.Install(link.Get(0)));
+    }
+    QueueDiscMemoryProbe queueMemory;
+    if (profile)
+    {
+        for (uint32_t q = 0; q < qd.GetN(); q++)
+        {
+            queueMemory.Attach(qd.Get(q));
+        }
+        for (uint32_t q = 0; q < edgeQd.GetN(); q++)
+        {
+            queueMemory.Attach(edgeQd.Get(q));
+        }
+    }
+    QueueEventProbe queueProbe(queueOptions);
+    Ptr<QueueDisc> lastQd = qd.Get(nBottlenecks - 1);
+    bool queueLocal = routers.Get(nBottlenecks - 1)->GetSystemId() == systemId;
+    if (queueLocal)
+    {
+        queueProbe.Attach(lastQd);
+        queueProbe.SetBinCallback(MakeCallback(&QueueBinTracer));
+        lastQd->TraceConnectWithoutContext("SojournTime", MakeCallback(&SojournTracer));
+    }
 
-    // Generate PCAP traces if enabled
+    // Short flows, on their own port so that the per-flow counters and flows.csv only
+    // count the bulk flows. Their received bytes are added to the utilization.
+    // The generator only exists with a workload and is created once the queue discs
+    // have drawn their automatic random streams; it uses fixed streams of its own.
+    std::unique_ptr<WorkloadGenerator> workloadGenerator;
+    if (workload)
+    {
+        workloadOptions.bottleneckBps = DataRate(bottleneckBandwidth).GetBitRate();
+        workloadOptions.port = port + 1;
+        workloadOptions.stop = stopTime;
+        workloadGenerator = std::make_unique<WorkloadGenerator>(flowSizes, workloadOptions);
+        workloadGenerator->AssignStreams(0);
+        for (uint32_t i = 0; i < nSenders; i++)
+        {
+            workloadGenerator->AddSender(sender.Get(i),
+                                         senderAddresses[i],
+                                         receiverAddresses[flows[i].receiver],
+                                         flows[i].abe);
+        }
+        for (uint32_t j = 0; j < nReceivers; j++)
+        {
+            workloadGenerator->AddSink(receiver.Get(j));
+        }
+        workloadGenerator->Start();
+    }
+
+    // Generate PCAP traces if enabled, on both ends of every bottleneck
+    PcapRing pcapCapture(pcapOptions);
+    pcapCapture.SetProfiler(profiler, SINK_PCAP);
     if (enablePcap)
     {
         MakeDirectories(dir + "pcap/");
-        bottleneckLink.EnablePcapAll(dir + "/pcap/cubic", true);
+        if (pcapRing)
+        {
+            for (auto& link : bottlenecks)
+            {
+                for (uint32_t d = 0; d < link.GetN(); d++)
+                {
+                    Ptr<NetDevice> device = link.Get(d);
+                    pcapCapture.Attach(device,
+                                       "cubic-" + std::to_string(device->GetNode()->GetId()) +
+                                           "-" + std::to_string(device->GetIfIndex()));
+                }
+            }
+            pcapCapture.Open(dir + "pcap/");
+        }
+        else
+        {
+            bottleneckLink.EnablePcapAll(dir + "/pcap/cubic", true);
+        }
     }
 
     // Open output files
-    throughputFile.open(dir + "/throughput.dat", std::ios::out);
-    queueSizeFile.open(dir + "/queueSize.dat", std::ios::out);
-    NS_ASSERT_MSG(throughputFile.is_open(), "Throughput file was not opened correctly");
-    NS_ASSERT_MSG(queueSizeFile.is_open(), "Queue size file was not opened correctly");
+    bool binaryTraces = (traceFormat == "binary");
+    bool multiFlow = (nSenders > 1);
+    // The cwnd file keeps its single-flow format as long as only flow 0 is traced
+    bool cwndFlowIds =
+        std::count(cwndTraced.begin(), cwndTraced.end(), true) != 1 || !cwndTraced[0];
+    OpenTraceFiles(binaryTraces, multiFlow, cwndFlowIds);
 
-    // Install FlowMonitor
+    // Install FlowMonitor on the end hosts only, routers add nothing to per-flow statistics
     FlowMonitorHelper flowmon;
-    Ptr<FlowMonitor> monitor = flowmon.InstallAll();
-    Simulator::Schedule(Seconds(0 + 0.000001), &TraceThroughput, monitor);
+    Ptr<FlowMonitor> monitor;
+    std::optional<FlowProbeTimer> flowProbeTimer;
+    if (!distributed)
+    {
+        // Bracket the FlowMonitor probes with a timer when profiling
+        NodeContainer endHosts(sender, receiver);
+        if (profiler)
+        {
+            flowProbeTimer.emplace(profiler, SINK_FLOW_MONITOR);
+            flowProbeTimer->Before(endHosts);
+        }
+        flowmon.Install(sender);
+        monitor = flowmon.Install(receiver);
+        if (flowProbeTimer)
+        {
+            flowProbeTimer->After(endHosts);
+        }
+    }
+    Simulator::Schedule(throughputInterval,
+                        &TraceThroughput,
+                        &probe,
+                        workloadGenerator.get(),
+                        uint64_t(0),
+                        throughputInterval);
+
+    // With a snapshot, run the warm-up once, then fork every branch from it. The
+    // warm-up traces stay in the output directory, each branch restarts the run
+    // totals and writes its traces and results from the snapshot time on to
+    // branch-<name>/.
+    std::string branchName = "";
+    auto runStart = std::chrono::steady_clock::now();
+    double setupSeconds = std::chrono::duration<double>(runStart - wallStart).count();
+    if (snapshot)
+    {
+        Simulator::Stop(snapshotTime);
+        Simulator::Run();
+        runSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart)
+                          .count();
+        queueProbe.Advance(Simulator::Now());
+        cwndSampler.Flush();
+        CloseTraceFiles();
+        pcapCapture.Close();
+
+        int branch = ForkBranches(branches, std::max(branchJobs, 1U));
+        if (branch < 0)
+        {
+            std::ofstream branchTable(dir + "branches.csv", std::ios::out);
+            branchTable << "branch,status,params\n";
+            uint32_t failed = 0;
+            for (const SnapshotBranch& b : branches)
+            {
+                branchTable << b.name << "," << b.status << ",";
+                for (const auto& [key, value] : b.params)
+                {
+                    branchTable << key << "=" << value << " ";
+                }
+                branchTable << "\n";
+                failed += (b.status != 0);
+            }
+            branchTable.close();
+            Simulator::Destroy();
+            return failed > 0 ? 1 : 0;
+        }
+
+        branchName = branches[branch].name;
+        dir = dir + "branch-" + branchName + "/";
+        resultDir = dir;
+        MakeDirectories(dir);
+        OpenTraceFiles(binaryTraces, multiFlow, cwndFlowIds);
+        if (pcapRing)
+        {
+            MakeDirectories(dir + "pcap/");
+            pcapCapture.Open(dir + "pcap/");
+        }
+        ResetRunTotals(monitor, queueProbe);
+        ApplyBranch(branches[branch]);
+    }
 
     // Run simulation
-    Simulator::Stop(stopTime + TimeStep(1));
+    Simulator::Stop(stopTime + TimeStep(1) - Simulator::Now());
+    runStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    runSeconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    queueProbe.Advance(Simulator::Now());
+    cwndSampler.Flush();
+    QueueTotals queueTotals;
+    if (queueLocal)
+    {
+        WriteSojournHistogram(queueProbe, queueOptions.sojournResolution);
+        queueTotals.avgPackets = queueProbe.GetAveragePackets();
+        queueTotals.enqueues = queueProbe.GetEnqueues();
+        queueTotals.marks = queueProbe.GetMarks();
+        queueTotals.earlyDrops = queueProbe.GetEarlyDrops();
+        queueTotals.forcedDrops = queueProbe.GetForcedDrops();
+        queueTotals.sojournP99Ms = queueProbe.GetSojournQuantile(0.99).ToDouble(Time::MS);
+    }
+
+    // In a distributed run, rank 0 collects the results of all ranks
+    std::vector<uint64_t> rxBytes;
+#ifdef NS3_MPI
+    if (distributed)
+    {
+        ReduceDistributedStats(probe, rxBytes, queueTotals);
+    }
+#endif
 
     // Log queue statistics and configuration
-    std::ofstream configFile;
-    configFile.open(dir + "config.txt", std::fstream::in | std::fstream::out | std::fstream::app);
-    configFile << "useEcn " << useEcn << "\n";
-    configFile << "queue disc type " << queueDisc << "\n";
-    configFile << "transport_prot " << tcpTypeId << "\n";
-    configFile << "dataSize " << dataSize << "\n";
-    configFile << "delAckCount " << delAckCount << "\n";
-    configFile << "stopTime " << stopTime << "\n";
-    configFile.close();
+    if (systemId == 0)
+    {
+        std::ostringstream config;
+        config << "useEcn " << useEcn << "\n";
+        config << "seed " << seed << "\n";
+        config << "run " << run << "\n";
+        config << "configHash " << HashConfig(configArgs) << "\n";
+        config << "queue disc type " << queueDisc << "\n";
+        config << "aqm " << aqm << "\n";
+        config << "aqmTarget " << aqmTarget << "\n";
+        config << "aqmInterval " << aqmInterval << "\n";
+        config << "transport_prot " << tcpTypeId << "\n";
+        config << "dataSize " << dataSize << "\n";
+        config << "delAckCount " << delAckCount << "\n";
+        config << "stopTime " << stopTime << "\n";
+        config << "traceFormat " << traceFormat << "\n";
+        config << "minTh " << minTh << "\n";
+        config << "maxTh " << maxTh << "\n";
+        config << "QW " << qW << "\n";
+        config << "AdaptMaxP " << AdaptMaxP << "\n";
+        config << "avgThroughput "
+               << (throughputSamples ? throughputSum / throughputSamples : 0.0) << "\n";
+        config << "avgQueueSize " << queueTotals.avgPackets << "\n";
+        config << "queueBin " << queueOptions.binInterval << "\n";
+        config << "queueEnqueues " << static_cast<uint64_t>(queueTotals.enqueues) << "\n";
+        config << "queueMarks " << static_cast<uint64_t>(queueTotals.marks) << "\n";
+        config << "queueEarlyDrops " << static_cast<uint64_t>(queueTotals.earlyDrops) << "\n";
+        config << "queueForcedDrops " << static_cast<uint64_t>(queueTotals.forcedDrops) << "\n";
+        config << "sojournP99Ms " << queueTotals.sojournP99Ms << "\n";
+        config << "nSenders " << nSenders << "\n";
+        config << "nReceivers " << nReceivers << "\n";
+        config << "nBottlenecks " << nBottlenecks << "\n";
+        config << "bottleneckBandwidth " << bottleneckBandwidth << "\n";
+        config << "bottleneckDelay " << bottleneckDelay << "\n";
+        config << "abeFraction " << abeFraction << "\n";
+        config << "altTcpTypeId " << altTcpTypeId << "\n";
+        config << "altTcpFraction " << altTcpFraction << "\n";
+        config << "throughputInterval " << throughputInterval << "\n";
+        config << "cwndFlows " << cwndFlows << "\n";
+        config << "cwndInterval " << cwndOptions.interval << "\n";
+        config << "cwndThreshold " << cwndOptions.threshold << "\n";
+        config << "cwndChanges " << cwndSampler.GetChanges() << "\n";
+        config << "cwndSamples " << cwndSampler.GetSamples() << "\n";
+        config << "abeAdaptive " << abeAdaptive << "\n";
+        config << "accEcn " << accEcn << "\n";
+        config << "pcapMode " << (enablePcap ? pcapMode : "off") << "\n";
+        if (pcapRing)
+        {
+            config << "pcapPackets " << pcapCapture.GetPackets() << "\n";
+        }
+        if (snapshot)
+        {
+            config << "snapshotTime " << snapshotTime << "\n";
+            config << "branch " << branchName << "\n";
+        }
+        if (distributed)
+        {
+            config << "distributedRanks " << systemCount << "\n";
+            WriteDistributedFlowStats(resultDir,
+                                      rxBytes,
+                                      stopTime,
+                                      bottleneckRateMbps,
+                                      config);
+        }
+        else
+        {
+            WriteFlowStats(monitor,
+                           DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier()),
+                           senderAddresses,
+                           port,
+                           bottleneckRateMbps,
+                           config);
+        }
+        WriteOnlineStats(config);
+        if (workload)
+        {
+            config << "workload " << workloadCdf << "\n";
+            config << "workloadLoad " << workloadOptions.load << "\n";
+            config << "workloadPool " << workloadOptions.poolSize << "\n";
+            config << "bulkFlows " << bulkFlows << "\n";
+            WriteFctStats(*workloadGenerator,
+                          fctEdges,
+                          snapshot ? snapshotTime : Seconds(0),
+                          config);
+        }
+        if (profile)
+        {
+            config << "profile " << profile << "\n";
+            WriteProfile(setupSeconds,
+                         runSeconds,
+                         EstimateFlowMonitorMemory(monitor),
+                         queueMemory,
+                         config);
+        }
+
+        std::ofstream configFile;
+        configFile.open(resultDir + "config.txt", std::fstream::out | std::fstream::trunc);
+        configFile << config.str();
+        configFile.close();
+        NS_ABORT_MSG_UNLESS(WriteSummaryJson(resultDir + "summary.json",
+                                             ParseConfig(config.str()),
+                                             OnlineSummaries()),
+                            "Cannot write " << resultDir << "summary.json");
+    }
 
     // Cleanup
     Simulator::Destroy();
-    throughputFile.close();
-    queueSizeFile.close();
+    CloseTraceFiles();
+    pcapCapture.Close();
+#ifdef NS3_MPI
+    if (distributed)
+    {
+        MpiInterface::Disable();
+    }
+#endif
 
     return 0;
 }
@@ -0,0 +1,354 @@
+/*
+* Parallel parameter sweep driver for ABE_Simulation.cc
+*
+* Expands a grid of ABE_Simulation command-line values (including raw ns-3
+* attributes such as ns3::TcpCubic::BetaEcn and the RngRun seed) into the
+* cartesian product of runs, and executes them on a pool of worker processes.
+* Every run is an isolated child process with its own output directory, so a
+* crashing configuration never takes the sweep down with it.
+*
+* Features:
+* - Grid file with one "key = v1, v2, ..." line per parameter, "a..b" integer ranges,
+*   or a points file listing the runs one by one (see abe-grid.h).
+* - Dynamic dispatch: a worker slot picks the next pending run as soon as it is free.
+* - Selected config.txt metrics of all runs aggregated into one results.csv table.
+*
+* Note: This driver has no ns-3 dependency, build it with
+*       g++ -std=c++17 -O2 -o abe-sweep ABE_Sweep.cc
+*/
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "abe-grid.h"
+
+/**
+* @brief One point of the sweep grid and its outcome.
+*/
+struct SweepRun
+{
+    uint32_t index;                  //!< Run index, also names the output directory
+    std::vector<std::string> values; //!< One value per grid axis
+    std::string dir;                 //!< Output directory of the run
+    pid_t pid{-1};                   //!< Worker process id while running
+    int status{-1};                  //!< Exit status, -1 if the run did not finish
+    double wallSeconds{0};           //!< Wall clock time taken by the run
+    std::chrono::steady_clock::time_point start; //!< Wall clock start of the run
+};
+
+/**
+* @brief Create the runs of a sweep.
+* @param points One value per axis for every run.
+* @param outputDir The sweep output directory.
+* @return All runs of the sweep.
+*/
+static std::vector<SweepRun>
+ExpandRuns(const std::vector<std::vector<std::string>>& points, const std::string& outputDir)
+{
+    std::vector<SweepRun> runs;
+    for (const auto& values : points)
+    {
+        SweepRun run;
+        run.index = runs.size();
+        run.values = values;
+        run.dir = outputDir + "/run-" + std::to_string(run.index);
+        runs.push_back(run);
+    }
+    return runs;
+}
+
+/**
+* @brief Start one run in its own worker process.
+* @param program The simulation binary.
+* @param grid The grid axes.
+* @param extraArgs Arguments passed unchanged to every run.
+* @param run The run to start.
+*/
+static void
+StartRun(const std::string& program,
+         const std::vector<GridAxis>& grid,
+         const std::vector<std::string>& extraArgs,
+         SweepRun& run)
+{
+    std::filesystem::create_directories(run.dir);
+
+    std::vector<std::string> args;
+    args.push_back(program);
+    for (size_t i = 0; i < grid.size(); i++)
+    {
+        args.push_back("--" + grid[i].key + "=" + run.values[i]);
+    }
+    args.insert(args.end(), extraArgs.begin(), extraArgs.end());
+    args.push_back("--outputDir=" + run.dir);
+
+    run.start = std::chrono::steady_clock::now();
+    run.pid = fork();
+    if (run.pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+    if (run.pid == 0)
+    {
+        // Worker: redirect output into the run directory and become the simulation
+        int log = open((run.dir + "/log.txt").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log >= 0)
+        {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+            close(log);
+        }
+        std::vector<char*> argv;
+        for (auto& arg : args)
+        {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        execv(program.c_str(), argv.data());
+        perror("execv");
+        _exit(127);
+    }
+}
+
+/**
+* @brief Read the "key value" summary lines a run wrote into its config.txt.
+* @param dir The run output directory.
+* @return Map from key to value, empty if the run produced no config.txt.
+*/
+static std::map<std::string, std::string>
+ReadRunSummary(const std::string& dir)
+{
+    std::map<std::string, std::string> summary;
+    std::ifstream in(dir + "/config.txt");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = Trim(line);
+        size_t space = line.find_last_of(' ');
+        if (space != std::string::npos)
+        {
+            summary[line.substr(0, space)] = line.substr(space + 1);
+        }
+    }
+    return summary;
+}
+
+int
+main(int argc, char* argv[])
+{
+    // Default configuration values
+    std::string program = "./ABE_Simulation";
+    std::string gridFile = "";
+    std::string pointsFile = "";
+    std::string outputDir = "";
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    bool dryRun = false;
+    std::string metrics = "avgThroughput,avgQueueSize,aggregateThroughput,jainIndex,delayP99Ms";
+    std::vector<std::string> extraArgs;
+
+    // Parse command-line arguments, anything unknown is forwarded to every run
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--program=", 0) == 0)
+        {
+            program = arg.substr(10);
+        }
+        else if (arg.rfind("--grid=", 0) == 0)
+        {
+            gridFile = arg.substr(7);
+        }
+        else if (arg.rfind("--points=", 0) == 0)
+        {
+            pointsFile = arg.substr(9);
+        }
+        else if (arg.rfind("--outputDir=", 0) == 0)
+        {
+            outputDir = arg.substr(12);
+        }
+        else if (arg.rfind("--jobs=", 0) == 0)
+        {
+            if (!ParseInteger(arg.substr(7), jobs) || jobs < 1)
+            {
+                std::cerr << "--jobs must be a positive integer, got '" << arg.substr(7) << "'"
+                          << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.rfind("--metrics=", 0) == 0)
+        {
+            metrics = arg.substr(10);
+        }
+        else if (arg == "--dryRun")
+        {
+            dryRun = true;
+        }
+        else if (arg == "--help")
+        {
+            std::cout << "Usage: " << argv[0]
+                      << " --grid=<file> | --points=<file> [--program=<ABE_Simulation binary>]"
+                         " [--jobs=N]"
+                         " [--outputDir=<dir>] [--metrics=<key,key,...>] [--dryRun]"
+                         " [--<simulation arg>=<value> ...]"
+                      << std::endl;
+            return 0;
+        }
+        else
+        {
+            extraArgs.push_back(arg);
+        }
+    }
+    if (gridFile.empty() == pointsFile.empty())
+    {
+        std::cerr << "Either a grid file or a points file is required, see --help" << std::endl;
+        return 1;
+    }
+    if (jobs < 1)
+    {
+        jobs = 1; // sysconf failed
+    }
+
+    // Create sweep directory
+    if (outputDir.empty())
+    {
+        time_t rawtime;
+        struct tm* timeinfo;
+        char buffer[80];
+        time(&rawtime);
+        timeinfo = localtime(&rawtime);
+        strftime(buffer, sizeof(buffer), "%d-%m-%Y-%I-%M-%S", timeinfo);
+        outputDir = "sweep-results/" + std::string(buffer);
+    }
+    std::filesystem::create_directories(outputDir);
+
+    // A points file lists the runs one by one, its header gives the axes
+    std::vector<GridAxis> grid;
+    std::vector<std::vector<std::string>> points;
+    if (!pointsFile.empty())
+    {
+        std::vector<std::string> keys;
+        points = ReadPoints(pointsFile, keys);
+        for (const std::string& key : keys)
+        {
+            grid.push_back(GridAxis{key, {}});
+        }
+    }
+    else
+    {
+        grid = ParseGrid(gridFile);
+        points = GridPoints(grid);
+    }
+    std::vector<SweepRun> runs = ExpandRuns(points, outputDir);
+    std::cout << runs.size() << " runs on " << jobs << " workers, results in " << outputDir
+              << std::endl;
+
+    if (dryRun)
+    {
+        for (auto& run : runs)
+        {
+            std::cout << program;
+            for (size_t i = 0; i < grid.size(); i++)
+            {
+                std::cout << " --" << grid[i].key << "=" << run.values[i];
+            }
+            for (auto& arg : extraArgs)
+            {
+                std::cout << " " << arg;
+            }
+            std::cout << " --outputDir=" << run.dir << std::endl;
+        }
+        return 0;
+    }
+
+    // Dispatch: keep every worker slot busy until the queue of runs is drained
+    size_t next = 0;
+    size_t finished = 0;
+    std::map<pid_t, size_t> active;
+    while (finished < runs.size())
+    {
+        while (next < runs.size() && active.size() < static_cast<size_t>(jobs))
+        {
+            StartRun(program, grid, extraArgs, runs[next]);
+            active[runs[next].pid] = next;
+            next++;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+        {
+            perror("wait");
+            return 1;
+        }
+        auto it = active.find(pid);
+        if (it == active.end())
+        {
+            continue;
+        }
+        SweepRun& run = runs[it->second];
+        active.erase(it);
+        run.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        run.wallSeconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - run.start).count();
+        finished++;
+        std::cout << "[" << finished << "/" << runs.size() << "] run-" << run.index
+                  << (run.status == 0 ? " done" : " FAILED (status " + std::to_string(run.status) + ")")
+                  << " in " << std::fixed << std::setprecision(1) << run.wallSeconds << "s"
+                  << std::endl;
+    }
+
+    // Aggregate per-run results into one table
+    std::ofstream table(outputDir + "/results.csv", std::ios::out);
+    table << "run";
+    for (auto& axis : grid)
+    {
+        table << "," << axis.key;
+    }
+    table << ",status,wallSeconds";
+    std::vector<std::string> metricKeys;
+    std::stringstream metricList(metrics);
+    std::string metric;
+    while (std::getline(metricList, metric, ','))
+    {
+        metricKeys.push_back(Trim(metric));
+        table << "," << metricKeys.back();
+    }
+    table << "\n";
+    uint32_t failed = 0;
+    for (auto& run : runs)
+    {
+        std::map<std::string, std::string> summary = ReadRunSummary(run.dir);
+        table << run.index;
+        for (auto& value : run.values)
+        {
+            table << "," << value;
+        }
+        table << "," << run.status << "," << run.wallSeconds;
+        for (auto& key : metricKeys)
+        {
+            table << "," << summary[key];
+        }
+        table << "\n";
+        failed += (run.status != 0);
+    }
+    table.close();
+
+    std::cout << runs.size() - failed << " of " << runs.size() << " runs succeeded, table written to "
+              << outputDir << "/results.csv" << std::endl;
+    return failed ? 1 : 0;
+}
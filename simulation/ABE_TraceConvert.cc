@@ -0,0 +1,100 @@
+/*
+* Converter from binary ABE trace files to the legacy .dat text format
+*
+* ABE_Simulation.cc --traceFormat=binary writes cwnd.bin, throughput.bin and
+* queueSize.bin (see abe-trace.h). This tool maps such a file and regenerates
+* the matching cwnd.dat / throughput.dat / queueSize.dat, so existing plotting
+* scripts keep working.
+*
+* Usage:
+*   ABE_TraceConvert <trace.bin> [output.dat] [--flow=N] [--withFlowId]
+*
+* Without an output file the .bin suffix is replaced by .dat.
+*
+* Note: This tool has no ns-3 dependency, build it with
+*       g++ -std=c++17 -O2 -o abe-trace-convert ABE_TraceConvert.cc
+*/
+
+#include "abe-trace.h"
+
+#include <iostream>
+#include <string>
+
+int
+main(int argc, char* argv[])
+{
+    std::string input;
+    std::string output;
+    int64_t flow = -1;
+    bool withFlowId = false;
+
+    // Parse command-line arguments
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--flow=", 0) == 0)
+        {
+            flow = std::stoll(arg.substr(7));
+        }
+        else if (arg == "--withFlowId")
+        {
+            withFlowId = true;
+        }
+        else if (input.empty())
+        {
+            input = arg;
+        }
+        else
+        {
+            output = arg;
+        }
+    }
+    if (input.empty())
+    {
+        std::cerr << "Usage: " << argv[0]
+                  << " <trace.bin> [output.dat] [--flow=N] [--withFlowId]" << std::endl;
+        return 1;
+    }
+    if (output.empty())
+    {
+        size_t dot = input.rfind(".bin");
+        output = (dot == std::string::npos ? input : input.substr(0, dot)) + ".dat";
+    }
+
+    TraceReader reader;
+    if (!reader.Open(input))
+    {
+        std::cerr << input << " is not a readable ABE trace file" << std::endl;
+        return 1;
+    }
+    FILE* out = fopen(output.c_str(), "w");
+    if (!out)
+    {
+        std::cerr << "Cannot open " << output << std::endl;
+        return 1;
+    }
+
+    uint32_t format = reader.GetHeader().timeFormat;
+    uint64_t samples = 0;
+    for (size_t b = 0; b < reader.GetBlockCount(); b++)
+    {
+        TraceReader::Block block = reader.GetBlock(b);
+        for (uint32_t i = 0; i < block.count; i++)
+        {
+            if (flow >= 0 && block.flowId[i] != flow)
+            {
+                continue;
+            }
+            if (withFlowId)
+            {
+                fprintf(out, "%u ", block.flowId[i]);
+            }
+            WriteTraceText(out, format, block.timeNs[i], block.value[i]);
+            samples++;
+        }
+    }
+    fclose(out);
+
+    std::cout << samples << " samples written to " << output << std::endl;
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+* AQM presets for the ABE simulation
+*
+* ABE (RFC 8511) only pays off if the bottleneck AQM marks early, with a
+* shallow target. ConfigureAqm() sets the attribute defaults of one of the
+* following queue discs, with ECN marking enabled, and returns its TypeId
+* name for TrafficControlHelper::SetRootQueueDisc():
+*
+*   red     RedQueueDisc, adaptive (ARED) and gentle, thresholds in packets
+*   codel   CoDelQueueDisc, 5 ms target, 100 ms interval (RFC 8289)
+*   fqcodel FqCoDelQueueDisc, CoDel per flow queue (RFC 8290)
+*   pie     PieQueueDisc, 15 ms delay reference (RFC 8033)
+*   fqpie   FqPieQueueDisc, PIE per flow queue
+*
+* Every preset gets the same buffer size, so that only the AQM differs
+* between runs.
+*/
+
+#ifndef ABE_AQM_H
+#define ABE_AQM_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <string>
+
+namespace ns3
+{
+
+/**
+* @brief AQM settings shared by the presets.
+*/
+struct AqmSettings
+{
+    bool useEcn{true};                   //!< Mark ECN-capable packets instead of dropping
+    std::string maxSize{"666p"};         //!< Buffer size of the queue disc
+    double minTh{5};                     //!< RED minimum threshold in packets
+    double maxTh{50};                    //!< RED maximum threshold in packets
+    double qW{0.5};                      //!< RED queue weight
+    bool adaptMaxP{false};               //!< RED adaptive maximum probability
+    std::string linkBandwidth{"10Mbps"}; //!< Rate of the bottleneck link, for RED
+    Time linkDelay{MilliSeconds(10)};    //!< Delay of the bottleneck link, for RED
+    Time target{Seconds(0)};             //!< CoDel target or PIE delay reference, 0 = preset
+    Time interval{Seconds(0)};           //!< CoDel interval, 0 = preset
+};
+
+/**
+* @brief Set the attribute defaults of an AQM preset.
+* @param aqm The preset name: red, codel, fqcodel, pie or fqpie.
+* @param settings The AQM settings.
+* @return The TypeId name of the queue disc.
+*/
+inline std::string
+ConfigureAqm(const std::string& aqm, const AqmSettings& settings)
+{
+    std::string typeId;
+    if (aqm == "red")
+    {
+        typeId = "ns3::RedQueueDisc";
+        Config::SetDefault(typeId + "::ARED", BooleanValue(true));
+        Config::SetDefault(typeId + "::Gentle", BooleanValue(true));
+        Config::SetDefault(typeId + "::MinTh", DoubleValue(settings.minTh));
+        Config::SetDefault(typeId + "::MaxTh", DoubleValue(settings.maxTh));
+        Config::SetDefault(typeId + "::AdaptMaxP", BooleanValue(settings.adaptMaxP));
+        Config::SetDefault(typeId + "::LinkBandwidth", StringValue(settings.linkBandwidth));
+        Config::SetDefault(typeId + "::LinkDelay", TimeValue(settings.linkDelay));
+        Config::SetDefault(typeId + "::MeanPktSize", UintegerValue(500));
+        Config::SetDefault(typeId + "::QW", DoubleValue(settings.qW));
+        Config::SetDefault(typeId + "::UseHardDrop", BooleanValue(false));
+    }
+    else if (aqm == "codel" || aqm == "fqcodel")
+    {
+        typeId = aqm == "codel" ? "ns3::CoDelQueueDisc" : "ns3::FqCoDelQueueDisc";
+        Time target = settings.target.IsStrictlyPositive() ? settings.target : MilliSeconds(5);
+        Time interval =
+            settings.interval.IsStrictlyPositive() ? settings.interval : MilliSeconds(100);
+        // CoDel takes its target and interval as strings
+        Config::SetDefault(typeId + "::Target",
+                           StringValue(std::to_string(target.GetNanoSeconds()) + "ns"));
+        Config::SetDefault(typeId + "::Interval",
+                           StringValue(std::to_string(interval.GetNanoSeconds()) + "ns"));
+    }
+    else if (aqm == "pie" || aqm == "fqpie")
+    {
+        typeId = aqm == "pie" ? "ns3::PieQueueDisc" : "ns3::FqPieQueueDisc";
+        Time target = settings.target.IsStrictlyPositive() ? settings.target : MilliSeconds(15);
+        Config::SetDefault(typeId + "::QueueDelayReference", TimeValue(target));
+    }
+    else
+    {
+        NS_FATAL_ERROR("Unknown AQM " << aqm << ", expected red, codel, fqcodel, pie or fqpie");
+    }
+    Config::SetDefault(typeId + "::UseEcn", BooleanValue(settings.useEcn));
+    Config::SetDefault(typeId + "::MaxSize", QueueSizeValue(QueueSize(settings.maxSize)));
+    return typeId;
+}
+
+} // namespace ns3
+
+#endif /* ABE_AQM_H */
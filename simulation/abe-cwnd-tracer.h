@@ -0,0 +1,231 @@
+/*
+* Decimated congestion window tracing for the ABE simulation
+*
+* CwndSampler connects to the CongestionWindow trace source of each traced
+* socket directly, without resolving a Config path, and converts the window
+* to segments with the segment size of that socket. A flow's window change is
+* logged only if both:
+*
+* - at least the sampling interval has passed since its last logged sample
+*   (time decimation), and
+* - it differs from its last logged value by at least the threshold, in
+*   segments (change decimation).
+*
+* A change that is not logged is kept as the flow's pending value, and is
+* logged by Flush() at the end of the run if it was the last one, so the
+* trace always ends at the final window. With an interval, at most one sample
+* per flow and interval is written however often the window changes. Each
+* change costs one comparison, so tracing thousands of flows has a bounded
+* cost per simulated second. With both settings at zero, every change is
+* logged.
+*/
+
+#ifndef ABE_CWND_TRACER_H
+#define ABE_CWND_TRACER_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+* @brief Congestion window sampler of a set of sockets.
+*/
+class CwndSampler
+{
+  public:
+    /**
+    * @brief Sampler settings.
+    */
+    struct Options
+    {
+        Time interval{Seconds(0)}; //!< Shortest time between two samples of a flow
+        double threshold{0};       //!< Smallest logged change of a flow, in segments
+    };
+
+    /**
+    * @brief Constructor
+    * @param options The sampler settings.
+    */
+    explicit CwndSampler(const Options& options)
+        : m_options(options)
+    {
+        NS_ABORT_MSG_IF(options.interval.IsStrictlyNegative() || options.threshold < 0,
+                        "Cwnd sampling interval and threshold must not be negative");
+    }
+
+    /**
+    * @brief Trace the congestion window of a socket, from now on.
+    * @param flowId The flow id the samples are tagged with.
+    * @param socket The TCP socket of the flow.
+    */
+    void Attach(uint32_t flowId, Ptr<TcpSocketBase> socket)
+    {
+        if (flowId >= m_flows.size())
+        {
+            m_flows.resize(flowId + 1);
+        }
+        m_flows[flowId].tcb = socket->GetSocketState();
+        socket->TraceConnectWithoutContext("CongestionWindow",
+                                           MakeBoundCallback(&CwndSampler::CwndChange,
+                                                             this,
+                                                             flowId));
+    }
+
+    /**
+    * @brief Set the function called with every logged sample.
+    * @param callback The callback, with the flow id, the time and the window in segments.
+    */
+    void SetSampleCallback(Callback<void, uint32_t, Time, double> callback)
+    {
+        m_sampleCallback = callback;
+    }
+
+    /**
+    * @brief Log the pending window of every flow whose last change was not logged.
+    */
+    void Flush()
+    {
+        for (uint32_t flowId = 0; flowId < m_flows.size(); flowId++)
+        {
+            Flow& flow = m_flows[flowId];
+            if (flow.pending)
+            {
+                Log(flowId, flow, flow.pendingTime, flow.pendingSegments);
+            }
+        }
+    }
+
+    /**
+    * @return Window changes seen so far.
+    */
+    uint64_t GetChanges() const
+    {
+        return m_changes;
+    }
+
+    /**
+    * @return Samples logged so far.
+    */
+    uint64_t GetSamples() const
+    {
+        return m_samples;
+    }
+
+  private:
+    /**
+    * @brief Decimation state of one flow.
+    */
+    struct Flow
+    {
+        Ptr<TcpSocketState> tcb;        //!< Socket state, for the segment size
+        bool logged{false};             //!< Whether a sample was logged yet
+        Time lastTime;                  //!< Time of the last logged sample
+        double lastSegments{0};         //!< Window of the last logged sample
+        bool pending{false};            //!< Whether a change is not logged yet
+        Time pendingTime;               //!< Time of the pending change
+        double pendingSegments{0};      //!< Window of the pending change
+    };
+
+    /**
+    * @brief CongestionWindow trace sink.
+    * @param sampler The sampler.
+    * @param flowId The flow of the socket.
+    * @param oldval Old window in bytes.
+    * @param newval New window in bytes.
+    */
+    static void CwndChange(CwndSampler* sampler, uint32_t flowId, uint32_t oldval, uint32_t newval)
+    {
+        sampler->m_changes++;
+        Flow& flow = sampler->m_flows[flowId];
+        Time now = Simulator::Now();
+        double segments = static_cast<double>(newval) / flow.tcb->m_segmentSize;
+        const Options& options = sampler->m_options;
+        if (!flow.logged || (now - flow.lastTime >= options.interval &&
+                             std::abs(segments - flow.lastSegments) >= options.threshold))
+        {
+            sampler->Log(flowId, flow, now, segments);
+            return;
+        }
+        flow.pending = true;
+        flow.pendingTime = now;
+        flow.pendingSegments = segments;
+    }
+
+    /**
+    * @brief Log one sample of a flow.
+    * @param flowId The flow id.
+    * @param flow The flow state.
+    * @param time Time of the sample.
+    * @param segments Window in segments.
+    */
+    void Log(uint32_t flowId, Flow& flow, Time time, double segments)
+    {
+        flow.logged = true;
+        flow.lastTime = time;
+        flow.lastSegments = segments;
+        flow.pending = false;
+        m_samples++;
+        if (!m_sampleCallback.IsNull())
+        {
+            m_sampleCallback(flowId, time, segments);
+        }
+    }
+
+    Options m_options;                                    //!< Sampler settings
+    std::vector<Flow> m_flows;                            //!< State per flow id
+    Callback<void, uint32_t, Time, double> m_sampleCallback; //!< Called with every sample
+    uint64_t m_changes{0};                                //!< Window changes seen
+    uint64_t m_samples{0};                                //!< Samples logged
+};
+
+/**
+* @brief Parse the set of traced flows.
+* @param flowList "all", "none", or comma-separated flow ids and "a..b" ranges.
+* @param nFlows Number of flows.
+* @return Whether each flow is traced.
+*/
+inline std::vector<bool>
+ParseFlowSet(const std::string& flowList, uint32_t nFlows)
+{
+    std::vector<bool> traced(nFlows, flowList == "all");
+    if (flowList == "all" || flowList == "none")
+    {
+        return traced;
+    }
+    std::stringstream in(flowList);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        size_t dots = item.find("..");
+        uint32_t first = 0;
+        uint32_t last = 0;
+        try
+        {
+            first = std::stoul(item.substr(0, dots));
+            last = dots == std::string::npos ? first : std::stoul(item.substr(dots + 2));
+        }
+        catch (const std::exception&)
+        {
+            NS_ABORT_MSG("Malformed flow list " << flowList);
+        }
+        NS_ABORT_MSG_IF(first > last || last >= nFlows,
+                        "Flow range " << item << " is not within 0.." << nFlows - 1);
+        for (uint32_t i = first; i <= last; i++)
+        {
+            traced[i] = true;
+        }
+    }
+    return traced;
+}
+
+} // namespace ns3
+
+#endif /* ABE_CWND_TRACER_H */
@@ -0,0 +1,200 @@
+/*
+* Incremental per-flow byte counters for the ABE simulation
+*
+* FlowDeltaProbe replaces polling FlowMonitor::GetFlowStats() on every sample
+* interval. Counters live in a flat array indexed by flow id and are updated
+* directly from the trace sources of the end hosts:
+*
+* - txBytes: IP bytes sent by the flow's sender node to the flow's TCP
+*   destination port (Ipv4L3Protocol "Tx"), headers and retransmissions
+*   included, as FlowMonitor counts them. Other connections of the node, such
+*   as the short flows of a workload, are not counted.
+* - rxBytes: application bytes delivered to the PacketSink ("Rx"), i.e. goodput.
+*
+* Every flow touched since the last Collect() is remembered in a change list,
+* so collecting an interval costs O(changed flows) and allocates nothing once
+* the list has grown to its working size.
+*/
+
+#ifndef ABE_FLOW_PROBE_H
+#define ABE_FLOW_PROBE_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+* @brief Per-flow byte counters with change tracking.
+*/
+class FlowDeltaProbe
+{
+  public:
+    /**
+    * @brief Bytes moved by one flow during the last interval.
+    */
+    struct Delta
+    {
+        uint32_t flowId;  //!< Flow id
+        uint64_t txBytes; //!< IP bytes sent during the interval
+        uint64_t rxBytes; //!< Application bytes received during the interval
+    };
+
+    /**
+    * @brief Constructor
+    * @param nFlows Number of flows, flow ids are 0 to nFlows - 1.
+    */
+    explicit FlowDeltaProbe(uint32_t nFlows)
+        : m_flows(nFlows)
+    {
+        m_changed.reserve(nFlows);
+        m_deltas.reserve(nFlows);
+    }
+
+    /**
+    * @brief Count the IP packets of a flow sent by a node.
+    * @param flowId The flow id.
+    * @param node The sender node, with only this flow on the destination port.
+    * @param address The sender address, used to attribute received bytes.
+    * @param port The TCP destination port of the flow.
+    */
+    void AttachSender(uint32_t flowId, Ptr<Node> node, Ipv4Address address, uint16_t port)
+    {
+        NS_ASSERT_MSG(flowId < m_flows.size(), "Flow id " << flowId << " out of range");
+        node->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+            "Tx",
+            MakeBoundCallback(&FlowDeltaProbe::SenderTx, this, flowId, port));
+        m_flowByAddress[address.Get()] = flowId;
+    }
+
+    /**
+    * @brief Count bytes delivered by a sink, attributed by the sender address.
+    * @param sink The PacketSink application.
+    */
+    void AttachSink(Ptr<PacketSink> sink)
+    {
+        sink->TraceConnectWithoutContext("Rx", MakeCallback(&FlowDeltaProbe::SinkRx, this));
+    }
+
+    /**
+    * @brief Collect the flows that moved bytes since the previous call.
+    * @return The per-flow deltas, valid until the next call.
+    */
+    const std::vector<Delta>& Collect()
+    {
+        m_deltas.clear();
+        for (uint32_t flowId : m_changed)
+        {
+            Counters& c = m_flows[flowId];
+            m_deltas.push_back({flowId, c.txBytes - c.lastTxBytes, c.rxBytes - c.lastRxBytes});
+            c.lastTxBytes = c.txBytes;
+            c.lastRxBytes = c.rxBytes;
+            c.changed = false;
+        }
+        m_changed.clear();
+        return m_deltas;
+    }
+
+    /**
+    * @param flowId The flow id.
+    * @return Total IP bytes sent by the flow.
+    */
+    uint64_t GetTxBytes(uint32_t flowId) const
+    {
+        return m_flows[flowId].txBytes;
+    }
+
+    /**
+    * @param flowId The flow id.
+    * @return Total application bytes received from the flow.
+    */
+    uint64_t GetRxBytes(uint32_t flowId) const
+    {
+        return m_flows[flowId].rxBytes;
+    }
+
+  private:
+    /**
+    * @brief Cumulative and last collected counters of one flow.
+    */
+    struct Counters
+    {
+        uint64_t txBytes{0};     //!< IP bytes sent
+        uint64_t rxBytes{0};     //!< Application bytes received
+        uint64_t lastTxBytes{0}; //!< txBytes at the last Collect()
+        uint64_t lastRxBytes{0}; //!< rxBytes at the last Collect()
+        bool changed{false};     //!< Whether the flow is in the change list
+    };
+
+    /**
+    * @brief Mark a flow as changed in the current interval.
+    * @param flowId The flow id.
+    */
+    void Touch(uint32_t flowId)
+    {
+        if (!m_flows[flowId].changed)
+        {
+            m_flows[flowId].changed = true;
+            m_changed.push_back(flowId);
+        }
+    }
+
+    /**
+    * @brief Ipv4L3Protocol Tx trace sink.
+    * @param probe The probe.
+    * @param flowId The flow of the sender node.
+    * @param port The TCP destination port of the flow.
+    * @param packet The packet, including the IP header.
+    * @param ipv4 The IPv4 stack.
+    * @param interface The outgoing interface.
+    */
+    static void SenderTx(FlowDeltaProbe* probe,
+                         uint32_t flowId,
+                         uint16_t port,
+                         Ptr<const Packet> packet,
+                         Ptr<Ipv4> ipv4,
+                         uint32_t interface)
+    {
+        // The 20-byte IPv4 header (NS-3 sends no IP options) is followed by the
+        // TCP source and destination ports; reading them copies no packet
+        uint8_t header[24];
+        if (packet->CopyData(header, sizeof(header)) < sizeof(header) ||
+            header[9] != TcpL4Protocol::PROT_NUMBER || (header[22] << 8 | header[23]) != port)
+        {
+            return;
+        }
+        probe->m_flows[flowId].txBytes += packet->GetSize();
+        probe->Touch(flowId);
+    }
+
+    /**
+    * @brief PacketSink Rx trace sink.
+    * @param packet The received data.
+    * @param from The sender address.
+    */
+    void SinkRx(Ptr<const Packet> packet, const Address& from)
+    {
+        auto it = m_flowByAddress.find(InetSocketAddress::ConvertFrom(from).GetIpv4().Get());
+        if (it == m_flowByAddress.end())
+        {
+            return;
+        }
+        m_flows[it->second].rxBytes += packet->GetSize();
+        Touch(it->second);
+    }
+
+    std::vector<Counters> m_flows;                          //!< Counters indexed by flow id
+    std::vector<uint32_t> m_changed;                        //!< Flows changed in this interval
+    std::vector<Delta> m_deltas;                            //!< Result of the last Collect()
+    std::unordered_map<uint32_t, uint32_t> m_flowByAddress; //!< Sender address to flow id
+};
+
+} // namespace ns3
+
+#endif /* ABE_FLOW_PROBE_H */
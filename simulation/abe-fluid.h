@@ -0,0 +1,488 @@
+/*
+* Fluid model of ABE flows over a RED bottleneck
+*
+* The packet-level simulation takes minutes per point. This model integrates
+* the mean behaviour of the same scenario (one bottleneck, N bulk flows of
+* CUBIC or Linux Reno, with or without ABE) in time steps, for many points
+* at once:
+*
+* - The flows of one class (congestion control, ABE or not) share one
+*   window W in segments; a point has up to four classes, as the flows of
+*   the simulation are split by altTcpFraction and abeFraction.
+* - The queue integrates the arrival rate sum(n W / R) minus the link rate C,
+*   with R = Tp + q / C, and is capped by the buffer size.
+* - RED averages the queue per arriving packet with weight QW and marks (or
+*   drops, without ECN) with the gentle RED probability, with the adaptive
+*   maximum probability of ARED if AdaptMaxP is set. With ARED, as in the
+*   red preset of abe-aqm.h, ns-3 replaces minTh, maxTh and QW by automatic
+*   values from the link rate and adapts the maximum probability, and so
+*   does the model.
+* - A flow expects p W / R marks per second. Once a class has collected one
+*   mark per flow, it reduces one RTT later (by BetaEcn with ABE, by Beta
+*   otherwise or on loss), at most once per RTT, as TCP does on ECN-Echo.
+*   A full buffer is a loss for every class.
+* - Between reductions, Reno grows by one segment per RTT and CUBIC follows
+*   W(t) = 0.4 (t - K)^3 + Wmax with fast convergence and its TCP-friendly
+*   estimate; both start in slow start.
+*
+* Points are stored as structures of arrays and every step is a loop over
+* the points without branches, which the compiler vectorizes (build with
+* -O3 -march=native -ffast-math -fopenmp-simd). All points run the same
+* number of steps, each with its own step, so a point on a fast link can
+* use a finer step than one on a slow link.
+*
+* The model ignores the random losses and the per-packet dynamics of the
+* simulation; it is meant to screen a parameter space, not to replace the
+* packet-level runs, and ABE_Fluid.cc reports its error against them.
+*
+* Note: This header has no ns-3 dependency.
+*/
+
+#ifndef ABE_FLUID_H
+#define ABE_FLUID_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+* @brief Parameters of one point, named after the ABE_Simulation options.
+*/
+struct FluidParams
+{
+    bool cubic{true};                //!< tcpTypeId is TcpCubic, else TcpLinuxReno
+    bool altCubic{false};            //!< altTcpTypeId is TcpCubic, else TcpLinuxReno
+    double cubicBeta{0.7};           //!< ns3::TcpCubic::Beta
+    double cubicBetaEcn{0.85};       //!< ns3::TcpCubic::BetaEcn
+    double renoBeta{0.5};            //!< ns3::TcpLinuxReno::Beta
+    double renoBetaEcn{0.7};         //!< ns3::TcpLinuxReno::BetaEcn
+    bool useEcn{true};               //!< Mark instead of dropping
+    uint32_t nSenders{1};            //!< Number of flows
+    double abeFraction{1};           //!< Fraction of flows with ABE
+    double altTcpFraction{0};        //!< Fraction of flows using altTcpTypeId
+    double minTh{5};                 //!< RED minimum threshold in packets
+    double maxTh{50};                //!< RED maximum threshold in packets
+    double qW{0.5};                  //!< RED queue weight
+    bool adaptMaxP{false};           //!< RED adaptive maximum probability
+    bool ared{true};                 //!< ns3::RedQueueDisc::ARED, as set by the red preset
+    double bufferPackets{666};       //!< Queue disc size in packets
+    double bandwidth{10e6};          //!< Bottleneck rate in bit/s
+    double bottleneckDelay{0.01};    //!< Bottleneck delay in seconds
+    double edgeDelay{0.005};         //!< Edge link delay in seconds
+    uint32_t dataSize{1448};         //!< Segment size in bytes
+    double stopTime{100};            //!< Simulated time in seconds
+    double startSpread{0};           //!< Flow starts spread over this time after 0.1 s
+};
+
+/**
+* @brief Results of one point, named after the config.txt keys they model.
+*/
+struct FluidResult
+{
+    double avgThroughput{0};    //!< Mean sending rate of flow 0 in Mbps, headers included
+    double goodputMbpsMean{0};  //!< Mean goodput of all flows in Mbps
+    double utilizationMean{0};  //!< Mean goodput over the bottleneck rate
+    double avgQueueSize{0};     //!< Time-averaged queue length in packets
+    double queueDelayMsMean{0}; //!< Mean queueing delay of the dequeued packets in ms
+    double ecnReductions{0};    //!< Window reductions on ECN, all flows
+    double lossReductions{0};   //!< Window reductions on loss, all flows
+};
+
+/**
+* @brief Vectorized fluid model over many points.
+*/
+class FluidModel
+{
+  public:
+    /// Bytes of IP, TCP (with timestamps) and PPP headers per segment
+    static constexpr double HEADER_BYTES = 54;
+    /// Number of flow classes per point
+    static constexpr int CLASSES = 4;
+
+    /**
+    * @brief Constructor
+    * @param points The parameters of every point.
+    * @param maxStep Longest time step in seconds.
+    * @param maxSteps Largest number of steps; the step of every point is
+    *        lengthened if needed.
+    */
+    FluidModel(const std::vector<FluidParams>& points, double maxStep = 1e-3,
+               uint64_t maxSteps = 10000000)
+        : m_points(points.size())
+    {
+        Resize();
+        double longest = 0;
+        for (size_t j = 0; j < m_points; j++)
+        {
+            const FluidParams& p = points[j];
+            m_c[j] = p.bandwidth / (8 * (p.dataSize + HEADER_BYTES));
+            m_tp[j] = 2 * (2 * p.edgeDelay + p.bottleneckDelay);
+            m_buffer[j] = p.bufferPackets;
+            double minTh = p.minTh;
+            double maxTh = p.maxTh;
+            double qW = p.qW;
+            if (p.ared)
+            {
+                // RedQueueDisc automatic settings, MeanPktSize 500 and TargetDelay 5 ms
+                double ptc = p.bandwidth / (8 * 500);
+                minTh = std::max(5.0, 0.005 * ptc / 2);
+                maxTh = 3 * minTh;
+                qW = 1 - std::exp(-1 / ptc);
+            }
+            m_minTh[j] = minTh;
+            m_maxTh[j] = std::max(maxTh, minTh + 1e-9);
+            m_log1mQw[j] = std::log1p(-std::min(qW, 1 - 1e-12));
+            m_maxP[j] = 0.02; // 1 / LInterm
+            m_adaptMaxP[j] = p.adaptMaxP || p.ared;
+            m_useEcn[j] = p.useEcn;
+            m_startSpread[j] = p.startSpread;
+            m_stop[j] = p.stopTime;
+            m_pktBits[j] = 8 * (p.dataSize + HEADER_BYTES);
+            m_payloadBits[j] = 8.0 * p.dataSize;
+            m_wCap[j] = 4194304.0 / p.dataSize; // SndBufSize
+
+            // Resolve the base RTT at a tenth
+            m_step[j] = std::min(maxStep, m_tp[j] / 10);
+            longest = std::max(longest, p.stopTime / m_step[j]);
+
+            // Flow i uses altTcpTypeId and ABE as in ABE_Simulation.cc
+            for (uint32_t i = 0; i < p.nSenders; i++)
+            {
+                bool alt = std::floor((i + 1) * p.altTcpFraction) > std::floor(i * p.altTcpFraction);
+                bool abe = std::floor((i + 1) * p.abeFraction) > std::floor(i * p.abeFraction);
+                int k = 2 * alt + !abe;
+                m_class[k].flows[j] += 1;
+                m_class[k].hasFlow0[j] += i == 0;
+            }
+            for (int k = 0; k < CLASSES; k++)
+            {
+                bool cubic = k < 2 ? p.cubic : p.altCubic;
+                double beta = cubic ? p.cubicBeta : p.renoBeta;
+                double betaEcn = cubic ? p.cubicBetaEcn : p.renoBetaEcn;
+                m_class[k].cubic[j] = cubic;
+                m_class[k].beta[j] = beta;
+                m_class[k].betaEcn[j] = k % 2 == 0 ? betaEcn : beta;
+            }
+        }
+        m_steps = static_cast<uint64_t>(std::ceil(std::min<double>(longest, maxSteps)));
+        for (size_t j = 0; j < m_points; j++)
+        {
+            m_step[j] = m_stop[j] / std::max<uint64_t>(m_steps, 1);
+        }
+    }
+
+    /**
+    * @return Number of time steps every point runs.
+    */
+    uint64_t GetSteps() const
+    {
+        return m_steps;
+    }
+
+    /**
+    * @brief Integrate every point up to its stop time.
+    * @return The results, in point order.
+    */
+    std::vector<FluidResult> Run()
+    {
+        for (uint64_t s = 0; s < m_steps; s++)
+        {
+            Step(s);
+        }
+        std::vector<FluidResult> results(m_points);
+        for (size_t j = 0; j < m_points; j++)
+        {
+            FluidResult& r = results[j];
+            r.avgThroughput = m_flow0Bits[j] / m_stop[j] / 1e6;
+            r.goodputMbpsMean = m_departed[j] * m_payloadBits[j] / m_stop[j] / 1e6;
+            r.utilizationMean = r.goodputMbpsMean / (m_c[j] * m_pktBits[j] / 1e6);
+            r.avgQueueSize = m_queueArea[j] / m_stop[j];
+            r.queueDelayMsMean = m_departed[j] > 0 ? m_delayArea[j] / m_departed[j] * 1e3 : 0;
+            r.ecnReductions = m_ecnReductions[j];
+            r.lossReductions = m_lossReductions[j];
+        }
+        return results;
+    }
+
+  private:
+    /**
+    * @brief State of one flow class, one element per point.
+    */
+    struct ClassState
+    {
+        std::vector<double> flows;      //!< Flows of the class
+        std::vector<double> active;     //!< Flows started so far
+        std::vector<double> cubic;      //!< 1 for CUBIC, 0 for Reno
+        std::vector<double> beta;       //!< Decrease factor on loss
+        std::vector<double> betaEcn;    //!< Decrease factor on ECN
+        std::vector<double> w;          //!< Window per flow in segments
+        std::vector<double> slowStart;  //!< 1 until the first reduction
+        std::vector<double> wMax;       //!< CUBIC window before the last reduction
+        std::vector<double> k;          //!< CUBIC time to reach wMax
+        std::vector<double> epoch;      //!< Time since the last reduction
+        std::vector<double> wEst;       //!< CUBIC TCP-friendly window estimate
+        std::vector<double> marks;      //!< Marks expected per flow since the last reduction
+        std::vector<double> pending;    //!< Time left until the scheduled reduction, < 0 if none
+        std::vector<double> pendingLoss; //!< 1 if the scheduled reduction is a loss
+        std::vector<double> freeze;     //!< Time left until the next reduction is allowed
+        std::vector<double> hasFlow0;   //!< 1 if flow 0 is in the class
+    };
+
+    /**
+    * @brief Allocate the arrays.
+    */
+    void Resize()
+    {
+        for (std::vector<double>* v : {&m_c,          &m_tp,        &m_buffer,        &m_minTh,
+                                       &m_maxTh,      &m_log1mQw,   &m_maxP,          &m_adaptMaxP,
+                                       &m_useEcn,     &m_startSpread, &m_stop,        &m_step,
+                                       &m_pktBits,    &m_payloadBits, &m_wCap,        &m_q,
+                                       &m_avg,        &m_aredTimer, &m_queueArea,     &m_delayArea,
+                                       &m_departed,   &m_flow0Bits, &m_ecnReductions, &m_lossReductions})
+        {
+            v->assign(m_points, 0);
+        }
+        for (ClassState& c : m_class)
+        {
+            for (std::vector<double>* v : {&c.flows, &c.active, &c.cubic,   &c.beta,
+                                           &c.betaEcn, &c.w,    &c.slowStart, &c.wMax,
+                                           &c.k,     &c.epoch,  &c.wEst,    &c.marks,
+                                           &c.pending, &c.pendingLoss, &c.freeze, &c.hasFlow0})
+            {
+                v->assign(m_points, 0);
+            }
+            c.pending.assign(m_points, -1);
+        }
+        m_arrival.assign(m_points, 0);
+        m_rtt.assign(m_points, 0);
+        m_p.assign(m_points, 0);
+        m_overflow.assign(m_points, 0);
+        m_flow0Rate.assign(m_points, 0);
+    }
+
+    /**
+    * @brief Advance every point by one step.
+    * @param s The step number.
+    */
+    void Step(uint64_t s)
+    {
+        const size_t n = m_points;
+        const double* __restrict c = m_c.data();
+        const double* __restrict tp = m_tp.data();
+        const double* __restrict dt = m_step.data();
+        double* __restrict q = m_q.data();
+        double* __restrict rtt = m_rtt.data();
+        double* __restrict arrival = m_arrival.data();
+
+        // Flows started so far, a new flow joins its class with 10 segments in slow start
+        for (ClassState& cl : m_class)
+        {
+            double* __restrict flows = cl.flows.data();
+            double* __restrict active = cl.active.data();
+            double* __restrict w = cl.w.data();
+            double* __restrict ss = cl.slowStart.data();
+            const double* __restrict spread = m_startSpread.data();
+#pragma omp simd
+            for (size_t j = 0; j < n; j++)
+            {
+                double t = s * dt[j];
+                // Without a spread, every flow starts within a nanosecond of 0.1 s
+                double started = std::fmin(std::fmax((t - 0.1) / std::fmax(spread[j], 1e-9), 0.0), 1.0);
+                double now = flows[j] * started;
+                double joined = now - active[j];
+                w[j] = now > 0 ? (w[j] * active[j] + 10 * joined) / now : 0;
+                ss[j] = active[j] == 0 && now > 0 ? 1 : ss[j];
+                active[j] = now;
+            }
+        }
+
+        // Queue
+#pragma omp simd
+        for (size_t j = 0; j < n; j++)
+        {
+            rtt[j] = tp[j] + q[j] / c[j];
+            arrival[j] = 0;
+            m_flow0Rate[j] = 0;
+        }
+        for (ClassState& cl : m_class)
+        {
+            const double* __restrict active = cl.active.data();
+            const double* __restrict w = cl.w.data();
+            const double* __restrict hasFlow0 = cl.hasFlow0.data();
+            double* __restrict flow0Rate = m_flow0Rate.data();
+#pragma omp simd
+            for (size_t j = 0; j < n; j++)
+            {
+                arrival[j] += active[j] * w[j] / rtt[j];
+                flow0Rate[j] += active[j] > 0 ? hasFlow0[j] * w[j] / rtt[j] : 0;
+            }
+        }
+        {
+            const double* __restrict buffer = m_buffer.data();
+            const double* __restrict minTh = m_minTh.data();
+            const double* __restrict maxTh = m_maxTh.data();
+            const double* __restrict log1mQw = m_log1mQw.data();
+            const double* __restrict maxP = m_maxP.data();
+            const double* __restrict pktBits = m_pktBits.data();
+            double* __restrict avg = m_avg.data();
+            double* __restrict p = m_p.data();
+            double* __restrict overflow = m_overflow.data();
+            double* __restrict queueArea = m_queueArea.data();
+            double* __restrict delayArea = m_delayArea.data();
+            double* __restrict departed = m_departed.data();
+            double* __restrict flow0Bits = m_flow0Bits.data();
+            const double* __restrict flow0Rate = m_flow0Rate.data();
+#pragma omp simd
+            for (size_t j = 0; j < n; j++)
+            {
+                double in = arrival[j] * dt[j];
+                double next = q[j] + in - c[j] * dt[j];
+                overflow[j] = next > buffer[j] ? 1 : 0;
+                double out = std::fmin(c[j] * dt[j], q[j] + in);
+                q[j] = std::fmin(std::fmax(next, 0.0), buffer[j]);
+                departed[j] += out;
+                delayArea[j] += out * q[j] / c[j];
+                queueArea[j] += q[j] * dt[j];
+
+                // Per-packet EWMA: (1 - QW)^packets of the old average is kept
+                avg[j] += (1 - std::exp(in * log1mQw[j])) * (q[j] - avg[j]);
+                double x = avg[j];
+                double linear = maxP[j] * (x - minTh[j]) / (maxTh[j] - minTh[j]);
+                double gentle = maxP[j] + (1 - maxP[j]) * (x - maxTh[j]) / maxTh[j];
+                p[j] = x < minTh[j] ? 0 : (x < maxTh[j] ? linear : std::fmin(gentle, 1.0));
+                flow0Bits[j] += flow0Rate[j] * pktBits[j] * dt[j];
+            }
+        }
+
+        // ARED: every 0.5 s, move maxP towards keeping the average in the middle
+        // of [minTh, maxTh]
+        {
+            const double* __restrict adapt = m_adaptMaxP.data();
+            const double* __restrict minTh = m_minTh.data();
+            const double* __restrict maxTh = m_maxTh.data();
+            const double* __restrict avg = m_avg.data();
+            double* __restrict maxP = m_maxP.data();
+            double* __restrict timer = m_aredTimer.data();
+#pragma omp simd
+            for (size_t j = 0; j < n; j++)
+            {
+                timer[j] += dt[j];
+                bool update = adapt[j] > 0 && timer[j] >= 0.5;
+                double low = minTh[j] + 0.4 * (maxTh[j] - minTh[j]);
+                double high = minTh[j] + 0.6 * (maxTh[j] - minTh[j]);
+                double up = avg[j] > high && maxP[j] <= 0.5 ? maxP[j] + std::fmin(0.01, maxP[j] / 4)
+                                                            : maxP[j];
+                double down = avg[j] < low && maxP[j] >= 0.01 ? maxP[j] * 0.9 : up;
+                maxP[j] = update ? down : maxP[j];
+                timer[j] = update ? 0 : timer[j];
+            }
+        }
+
+        // Window of every class
+        const double* __restrict p = m_p.data();
+        const double* __restrict overflow = m_overflow.data();
+        const double* __restrict useEcn = m_useEcn.data();
+        const double* __restrict wCap = m_wCap.data();
+        double* __restrict ecnReductions = m_ecnReductions.data();
+        double* __restrict lossReductions = m_lossReductions.data();
+        for (ClassState& cl : m_class)
+        {
+            const double* __restrict active = cl.active.data();
+            const double* __restrict cubic = cl.cubic.data();
+            const double* __restrict beta = cl.beta.data();
+            const double* __restrict betaEcn = cl.betaEcn.data();
+            double* __restrict w = cl.w.data();
+            double* __restrict ss = cl.slowStart.data();
+            double* __restrict wMax = cl.wMax.data();
+            double* __restrict kk = cl.k.data();
+            double* __restrict epoch = cl.epoch.data();
+            double* __restrict wEst = cl.wEst.data();
+            double* __restrict marks = cl.marks.data();
+            double* __restrict pending = cl.pending.data();
+            double* __restrict pendingLoss = cl.pendingLoss.data();
+            double* __restrict freeze = cl.freeze.data();
+#pragma omp simd
+            for (size_t j = 0; j < n; j++)
+            {
+                // Flags are 0 or 1 and blend the updates, which keeps the loop vectorizable
+                double on = active[j] > 0 ? 1 : 0;
+                double r = rtt[j];
+
+                // Schedule a reduction one RTT after enough marks, or a full buffer
+                marks[j] += on * p[j] * w[j] / r * dt[j];
+                double idle = (pending[j] < 0 ? 1 : 0) * (freeze[j] <= 0 ? 1 : 0);
+                double signal = on * idle * (marks[j] >= 1 ? 1 : 0);
+                double loss = on * idle * overflow[j];
+                double start = std::fmax(signal, loss);
+                pendingLoss[j] += start * (std::fmax(loss, signal * (1 - useEcn[j])) - pendingLoss[j]);
+                pending[j] = start * r + (1 - start) * (pending[j] - dt[j]);
+                marks[j] *= 1 - start;
+                double fire = on * (pending[j] < 0 ? 1 : 0) * (pending[j] + dt[j] >= 0 ? 1 : 0);
+
+                // Reduction: BetaEcn on ECN with ABE, Beta on loss or without ABE
+                double b = pendingLoss[j] > 0 ? beta[j] : betaEcn[j];
+                double reduced = std::fmax(w[j] * b, 2.0);
+                double lastMax = w[j] < wMax[j] ? w[j] * (1 + beta[j]) / 2 : w[j];
+                // cbrt() has no vector variant, exp(log(x) / 3) has
+                double kNew = std::exp(std::log(std::fmax(lastMax - reduced, 1e-9) / 0.4) / 3);
+
+                // Growth: slow start doubles per RTT, Reno adds a segment per RTT,
+                // CUBIC closes the gap to W(t + RTT) over one RTT
+                double t = epoch[j] + dt[j];
+                double cubicTarget = wMax[j] + 0.4 * (t + r - kk[j]) * (t + r - kk[j]) * (t + r - kk[j]);
+                double est = wEst[j] + 3 * (1 - beta[j]) / (1 + beta[j]) * dt[j] / r;
+                double target = std::fmax(cubicTarget, est);
+                double cubicGrowth = std::fmin(std::fmax((target - w[j]) / r, w[j] / (100 * r)), w[j] / (2 * r));
+                double growth = ss[j] > 0 ? w[j] / r : (cubic[j] > 0 ? cubicGrowth : 1 / r);
+                double grown = std::fmin(w[j] + growth * dt[j], wCap[j]);
+
+                w[j] += on * (grown - w[j]) + fire * (reduced - grown);
+                wMax[j] += fire * (lastMax - wMax[j]);
+                kk[j] += fire * (kNew - kk[j]);
+                epoch[j] = (1 - fire) * t;
+                wEst[j] = est + fire * (reduced - est);
+                ss[j] *= 1 - fire;
+                freeze[j] = fire * r + (1 - fire) * (freeze[j] - dt[j]);
+                ecnReductions[j] += fire * (1 - pendingLoss[j]) * active[j];
+                lossReductions[j] += fire * pendingLoss[j] * active[j];
+            }
+        }
+    }
+
+    size_t m_points;                           //!< Number of points
+    uint64_t m_steps{0};                       //!< Steps run by every point
+    std::vector<double> m_c;                   //!< Link rate in packets per second
+    std::vector<double> m_tp;                  //!< Base RTT in seconds
+    std::vector<double> m_buffer;              //!< Buffer size in packets
+    std::vector<double> m_minTh;               //!< RED minimum threshold
+    std::vector<double> m_maxTh;               //!< RED maximum threshold
+    std::vector<double> m_log1mQw;             //!< log(1 - QW)
+    std::vector<double> m_maxP;                //!< RED maximum probability
+    std::vector<double> m_adaptMaxP;           //!< 1 with adaptive maximum probability
+    std::vector<double> m_useEcn;              //!< 1 with ECN marking
+    std::vector<double> m_startSpread;         //!< Flow start spread in seconds
+    std::vector<double> m_stop;                //!< Stop time in seconds
+    std::vector<double> m_step;                //!< Time step in seconds
+    std::vector<double> m_pktBits;             //!< Bits per packet on the link
+    std::vector<double> m_payloadBits;         //!< Payload bits per packet
+    std::vector<double> m_wCap;                //!< Largest window, from the send buffer
+    std::vector<double> m_q;                   //!< Queue length in packets
+    std::vector<double> m_avg;                 //!< RED average queue length
+    std::vector<double> m_aredTimer;           //!< Time since the last ARED update
+    std::vector<double> m_queueArea;           //!< Queue length integral
+    std::vector<double> m_delayArea;           //!< Sum of the queueing delays of the departures
+    std::vector<double> m_departed;            //!< Packets dequeued
+    std::vector<double> m_flow0Bits;           //!< Bits sent by flow 0
+    std::vector<double> m_ecnReductions;       //!< Reductions on ECN
+    std::vector<double> m_lossReductions;      //!< Reductions on loss
+    std::vector<double> m_arrival;             //!< Arrival rate of the step
+    std::vector<double> m_rtt;                 //!< RTT of the step
+    std::vector<double> m_p;                   //!< Marking probability of the step
+    std::vector<double> m_overflow;            //!< 1 if the buffer overflowed in the step
+    std::vector<double> m_flow0Rate;           //!< Sending rate of flow 0 in the step
+    std::array<ClassState, CLASSES> m_class;   //!< Flow classes
+};
+
+#endif /* ABE_FLUID_H */
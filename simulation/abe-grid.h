@@ -0,0 +1,250 @@
+/*
+* Parameter grids and point lists for the ABE tools
+*
+* A grid file has one "key = v1, v2, ..." line per parameter, "a..b" integer
+* ranges, and "#" comments; it describes the cartesian product of all its
+* lines. A points file is a CSV table with one header line of keys and one
+* line of values per point, e.g. the points selected by ABE_Fluid.cc.
+*
+* Note: This header has no ns-3 dependency.
+*/
+
+#ifndef ABE_GRID_H
+#define ABE_GRID_H
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+* @brief One dimension of the sweep grid.
+*/
+struct GridAxis
+{
+    std::string key;                 //!< Argument name passed to the simulation
+    std::vector<std::string> values; //!< Values to sweep over
+};
+
+/**
+* @brief Remove leading and trailing whitespace.
+* @param s The input string.
+* @return The trimmed string.
+*/
+inline std::string
+Trim(const std::string& s)
+{
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+    {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+/**
+* @brief Split a line at a separator, trimming every field.
+* @param line The line.
+* @param separator The field separator.
+* @return The fields.
+*/
+inline std::vector<std::string>
+SplitFields(const std::string& line, char separator)
+{
+    std::vector<std::string> fields;
+    std::stringstream in(line);
+    std::string field;
+    while (std::getline(in, field, separator))
+    {
+        fields.push_back(Trim(field));
+    }
+    // getline() drops an empty last field
+    if (!line.empty() && line.back() == separator)
+    {
+        fields.push_back("");
+    }
+    return fields;
+}
+
+/**
+* @brief Parse a whole string as an integer.
+* @param text The string.
+* @param value The parsed integer.
+* @return False if the string is empty, has anything but the integer, or overflows.
+*/
+inline bool
+ParseInteger(const std::string& text, long& value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtol(text.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+/**
+* @brief Expand a grid value, turning an "a..b" integer range into its members.
+*
+* Only values whose both ends are integers are ranges; any other value, such as
+* a path like "../x.txt" or "0.5..0.9", is kept as written.
+*
+* @param value The value as written in the grid file.
+* @param out The list the expanded values are appended to.
+*/
+inline void
+ExpandValue(const std::string& value, std::vector<std::string>& out)
+{
+    size_t dots = value.find("..");
+    long first;
+    long last;
+    if (dots == std::string::npos || !ParseInteger(value.substr(0, dots), first) ||
+        !ParseInteger(value.substr(dots + 2), last))
+    {
+        out.push_back(value);
+        return;
+    }
+    for (long v = first; v <= last; v++)
+    {
+        out.push_back(std::to_string(v));
+    }
+}
+
+/**
+* @brief Parse a grid file.
+* @param path The grid file path.
+* @return The grid axes in file order.
+*/
+inline std::vector<GridAxis>
+ParseGrid(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        std::cerr << "Cannot open grid file " << path << std::endl;
+        exit(1);
+    }
+
+    std::vector<GridAxis> grid;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+        size_t eq = line.find('=');
+        if (eq == std::string::npos)
+        {
+            std::cerr << "Malformed grid line: " << line << std::endl;
+            exit(1);
+        }
+        GridAxis axis;
+        axis.key = Trim(line.substr(0, eq));
+        for (const std::string& value : SplitFields(line.substr(eq + 1), ','))
+        {
+            if (!value.empty())
+            {
+                ExpandValue(value, axis.values);
+            }
+        }
+        if (axis.key.empty() || axis.values.empty())
+        {
+            std::cerr << "Grid line without key or values: " << line << std::endl;
+            exit(1);
+        }
+        grid.push_back(axis);
+    }
+    return grid;
+}
+
+/**
+* @brief Enumerate the cartesian product of a grid.
+* @param grid The grid axes.
+* @return One value per axis for every point, last axis fastest.
+*/
+inline std::vector<std::vector<std::string>>
+GridPoints(const std::vector<GridAxis>& grid)
+{
+    std::vector<std::vector<std::string>> points;
+    std::vector<size_t> cursor(grid.size(), 0);
+    while (true)
+    {
+        std::vector<std::string> values;
+        for (size_t i = 0; i < grid.size(); i++)
+        {
+            values.push_back(grid[i].values[cursor[i]]);
+        }
+        points.push_back(values);
+
+        // Advance the odometer, last axis fastest
+        size_t axis = grid.size();
+        while (axis > 0)
+        {
+            axis--;
+            if (++cursor[axis] < grid[axis].values.size())
+            {
+                break;
+            }
+            cursor[axis] = 0;
+            if (axis == 0)
+            {
+                return points;
+            }
+        }
+        if (grid.empty())
+        {
+            return points;
+        }
+    }
+}
+
+/**
+* @brief Read a points file.
+* @param path The CSV file path.
+* @param keys Set to the keys of the header line.
+* @return One value per key for every point, in file order.
+*/
+inline std::vector<std::vector<std::string>>
+ReadPoints(const std::string& path, std::vector<std::string>& keys)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        std::cerr << "Cannot open points file " << path << std::endl;
+        exit(1);
+    }
+    std::vector<std::vector<std::string>> points;
+    std::string line;
+    keys.clear();
+    while (std::getline(in, line))
+    {
+        if (Trim(line).empty())
+        {
+            continue;
+        }
+        std::vector<std::string> fields = SplitFields(line, ',');
+        if (keys.empty())
+        {
+            keys = fields;
+            continue;
+        }
+        if (fields.size() != keys.size())
+        {
+            std::cerr << "Points line with " << fields.size() << " values for " << keys.size()
+                      << " keys: " << line << std::endl;
+            exit(1);
+        }
+        points.push_back(fields);
+    }
+    return points;
+}
+
+#endif /* ABE_GRID_H */
@@ -0,0 +1,330 @@
+/*
+* Streaming pcap capture for the ABE simulation
+*
+* PcapRing replaces PointToPointHelper::EnablePcapAll(), which writes every
+* packet in full for the whole run. It hooks the PromiscSniffer trace of the
+* bottleneck devices and:
+*
+* - truncates every packet to a snap length (by default the PPP, IPv4 and TCP
+*   headers), the original length is kept in the record header;
+* - captures only inside a time window, and optionally only CE-marked packets
+*   and TCP segments with ECE set;
+* - batches records in a memory buffer and writes it with one fwrite();
+* - rotates through a bounded ring of files per device,
+*   <prefix>-<node>-<device>-<k>.pcap with k = 0 .. maxFiles - 1, overwriting
+*   the oldest file when the ring is full.
+*
+* The files are standard pcap files (link type PPP), readable by tcpdump and
+* Wireshark. With a profiler, the sniffer sink, including its file writes, is
+* timed as a profiled sink.
+*/
+
+#ifndef ABE_PCAP_H
+#define ABE_PCAP_H
+
+#include "abe-profiler.h"
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+* @brief Bounded, filtered pcap capture of point-to-point devices.
+*/
+class PcapRing
+{
+  public:
+    /**
+    * @brief Capture settings.
+    */
+    struct Options
+    {
+        uint32_t snaplen{96};            //!< Bytes kept per packet
+        Time start{Seconds(0)};          //!< Start of the capture window
+        Time stop{Time::Max()};          //!< End of the capture window
+        bool ecnOnly{false};             //!< Capture only CE-marked or ECE-flagged packets
+        uint32_t maxFiles{4};            //!< Files per device, 0 = never overwrite
+        uint64_t maxFileBytes{64 << 20}; //!< Size at which a file is rotated
+        uint32_t bufferBytes{1 << 20};   //!< Write batch size per device
+    };
+
+    /**
+    * @brief Constructor
+    * @param options The capture settings.
+    */
+    explicit PcapRing(const Options& options)
+        : m_options(options)
+    {
+    }
+
+    PcapRing(const PcapRing&) = delete;
+    PcapRing& operator=(const PcapRing&) = delete;
+
+    ~PcapRing()
+    {
+        Close();
+    }
+
+    /**
+    * @brief Capture the packets seen by a device.
+    * @param device The point-to-point device.
+    * @param name File name prefix of the device, without directory.
+    */
+    void Attach(Ptr<NetDevice> device, const std::string& name)
+    {
+        auto capture = std::make_unique<Capture>();
+        capture->ring = this;
+        capture->name = name;
+        device->TraceConnectWithoutContext("PromiscSniffer",
+                                           MakeBoundCallback(&PcapRing::Sniff, capture.get()));
+        m_captures.push_back(std::move(capture));
+    }
+
+    /**
+    * @brief Time the sniffer sink of every device as one profiled sink.
+    * @param profiler The profiling scheduler, or null.
+    * @param sink The sink id.
+    */
+    void SetProfiler(ProfilingSimulatorImpl* profiler, uint32_t sink)
+    {
+        m_profiler = profiler;
+        m_profileSink = sink;
+    }
+
+    /**
+    * @brief Start writing the files of every attached device in a directory.
+    *
+    * Closes any files opened before, so that a forked snapshot branch can
+    * continue the capture in its own directory.
+    *
+    * @param dir The output directory, ending with "/".
+    */
+    void Open(const std::string& dir)
+    {
+        Close();
+        m_dir = dir;
+        for (auto& capture : m_captures)
+        {
+            capture->buffer.resize(std::max<size_t>(m_options.bufferBytes, RecordBytes(65535)));
+            capture->used = 0;
+            capture->fileIndex = 0;
+            OpenFile(*capture);
+        }
+    }
+
+    /**
+    * @brief Write any buffered records and close all files.
+    */
+    void Close()
+    {
+        for (auto& capture : m_captures)
+        {
+            if (capture->file)
+            {
+                Flush(*capture);
+                fclose(capture->file);
+                capture->file = nullptr;
+            }
+        }
+    }
+
+    /**
+    * @return The number of packets captured on all devices.
+    */
+    uint64_t GetPackets() const
+    {
+        uint64_t packets = 0;
+        for (const auto& capture : m_captures)
+        {
+            packets += capture->packets;
+        }
+        return packets;
+    }
+
+  private:
+    /**
+    * @brief Header at the start of every pcap file.
+    */
+    struct FileHeader
+    {
+        uint32_t magic;        //!< 0xa1b2c3d4, timestamps in microseconds
+        uint16_t versionMajor; //!< 2
+        uint16_t versionMinor; //!< 4
+        int32_t thisZone;      //!< Always 0 (UTC)
+        uint32_t sigFigs;      //!< Always 0
+        uint32_t snaplen;      //!< Bytes kept per packet
+        uint32_t linkType;     //!< Link type of the packets
+    };
+
+    /**
+    * @brief Header in front of every captured packet.
+    */
+    struct RecordHeader
+    {
+        uint32_t seconds;      //!< Timestamp, seconds
+        uint32_t microseconds; //!< Timestamp, microseconds
+        uint32_t included;     //!< Bytes stored in the file
+        uint32_t original;     //!< Length of the packet
+    };
+
+    /// Size of the pcap file header
+    static constexpr uint32_t FILE_HEADER_BYTES = sizeof(FileHeader);
+    /// Size of the pcap record header
+    static constexpr uint32_t RECORD_HEADER_BYTES = sizeof(RecordHeader);
+    /// Bytes needed to find the TCP flags behind the PPP and IPv4 headers
+    static constexpr uint32_t ECN_PARSE_BYTES = 2 + 60 + 14;
+    /// Link type of point-to-point devices
+    static constexpr uint32_t LINKTYPE_PPP = 9;
+
+    /**
+    * @brief Capture state of one device.
+    */
+    struct Capture
+    {
+        PcapRing* ring{nullptr};     //!< Owning ring
+        std::string name;            //!< File name prefix
+        FILE* file{nullptr};         //!< Current file
+        uint32_t fileIndex{0};       //!< Index of the current file
+        uint64_t fileBytes{0};       //!< Bytes written to the current file
+        std::vector<uint8_t> buffer; //!< Records not yet written
+        size_t used{0};              //!< Bytes used in buffer
+        uint64_t packets{0};         //!< Packets captured
+    };
+
+    /**
+    * @param dataBytes Bytes of packet data in a record.
+    * @return The size of a record, including the bytes parsed by the ECN filter.
+    */
+    static size_t RecordBytes(uint32_t dataBytes)
+    {
+        return RECORD_HEADER_BYTES + std::max(dataBytes, ECN_PARSE_BYTES);
+    }
+
+    /**
+    * @brief Check whether a packet carries an ECN congestion signal.
+    * @param data The packet, starting with the PPP header.
+    * @param length The number of bytes available.
+    * @return True if the IPv4 header is CE-marked or the TCP header has ECE set.
+    */
+    static bool IsCongestionSignal(const uint8_t* data, uint32_t length)
+    {
+        // PPP protocol 0x0021 is IPv4
+        if (length < 2 + 20 || data[0] != 0x00 || data[1] != 0x21)
+        {
+            return false;
+        }
+        const uint8_t* ip = data + 2;
+        if ((ip[1] & 0x03) == 0x03)
+        {
+            return true;
+        }
+        uint32_t ihl = (ip[0] & 0x0f) * 4;
+        if (ip[9] != 6 || length < 2 + ihl + 14)
+        {
+            return false;
+        }
+        return (ip[ihl + 13] & 0x40) != 0;
+    }
+
+    /**
+    * @brief PromiscSniffer trace sink.
+    * @param capture The capture of the device.
+    * @param packet The packet, including the PPP header.
+    */
+    static void Sniff(Capture* capture, Ptr<const Packet> packet)
+    {
+        ProfileScope scope(capture->ring->m_profiler, capture->ring->m_profileSink);
+        const Options& options = capture->ring->m_options;
+        Time now = Simulator::Now();
+        if (!capture->file || now < options.start || now > options.stop)
+        {
+            return;
+        }
+        uint32_t size = packet->GetSize();
+        uint32_t included = std::min(size, options.snaplen);
+        if (capture->used + RecordBytes(included) > capture->buffer.size())
+        {
+            capture->ring->Flush(*capture);
+        }
+
+        // Copy the packet data directly into the write buffer, and drop it again
+        // if the filter rejects it
+        uint8_t* record = capture->buffer.data() + capture->used;
+        uint32_t copied =
+            packet->CopyData(record + RECORD_HEADER_BYTES,
+                             options.ecnOnly ? std::max(included, ECN_PARSE_BYTES) : included);
+        if (options.ecnOnly && !IsCongestionSignal(record + RECORD_HEADER_BYTES, copied))
+        {
+            return;
+        }
+
+        int64_t us = now.GetMicroSeconds();
+        RecordHeader header{static_cast<uint32_t>(us / 1000000),
+                            static_cast<uint32_t>(us % 1000000),
+                            included,
+                            size};
+        memcpy(record, &header, sizeof(header));
+        capture->used += RECORD_HEADER_BYTES + included;
+        capture->packets++;
+    }
+
+    /**
+    * @brief Open the current file of a capture and write the pcap header.
+    * @param capture The capture.
+    */
+    void OpenFile(Capture& capture)
+    {
+        std::string path = m_dir + capture.name + "-" + std::to_string(capture.fileIndex) + ".pcap";
+        capture.file = fopen(path.c_str(), "wb");
+        NS_ABORT_MSG_UNLESS(capture.file, "Cannot open " << path);
+        FileHeader header{0xa1b2c3d4, 2, 4, 0, 0, m_options.snaplen, LINKTYPE_PPP};
+        fwrite(&header, sizeof(header), 1, capture.file);
+        capture.fileBytes = FILE_HEADER_BYTES;
+    }
+
+    /**
+    * @brief Write the buffered records, rotating to the next file of the ring
+    *        first if they do not fit in the current one.
+    * @param capture The capture.
+    */
+    void Flush(Capture& capture)
+    {
+        if (capture.used == 0)
+        {
+            return;
+        }
+        if (capture.fileBytes > FILE_HEADER_BYTES &&
+            capture.fileBytes + capture.used > m_options.maxFileBytes)
+        {
+            fclose(capture.file);
+            capture.fileIndex++;
+            if (m_options.maxFiles > 0)
+            {
+                capture.fileIndex %= m_options.maxFiles;
+            }
+            OpenFile(capture);
+        }
+        fwrite(capture.buffer.data(), capture.used, 1, capture.file);
+        capture.fileBytes += capture.used;
+        capture.used = 0;
+    }
+
+    Options m_options;                                //!< Capture settings
+    std::string m_dir;                                //!< Output directory
+    std::vector<std::unique_ptr<Capture>> m_captures; //!< One capture per device
+    ProfilingSimulatorImpl* m_profiler{nullptr};      //!< Profiling scheduler, or null
+    uint32_t m_profileSink{0};                        //!< Sink id of Sniff
+};
+
+} // namespace ns3
+
+#endif /* ABE_PCAP_H */
@@ -0,0 +1,460 @@
+/*
+* Wall-clock and memory profiling of the ABE simulation
+*
+* ProfilingSimulatorImpl is the default NS-3 scheduler with a wall-clock timer
+* around every event. Events are grouped by the type of their EventImpl, which
+* the compiler derives from the signature of the scheduled function or member
+* function and its bound arguments, without any change to the code scheduling
+* them. Functions of the same signature share a type and thus a line: all
+* void (TcpSocketBase::*)() timers (retransmission, delayed ACK, persist) are
+* one line, as are all static functions taking no arguments. Trace sinks run
+* inside the event that fires them; the sinks of interest are timed separately
+* with a ProfileScope, and their time is also part of the time of their event.
+* FlowProbeTimer times the per-packet FlowMonitor probes the same way.
+*
+* Memory is reported as the peak resident set size of the process, plus
+* estimates of the state that grows with the run:
+*
+* - FlowMonitor: flow statistics, histograms, per-probe statistics and the
+*   classifier tables, from their sizes at the end of the run.
+* - Queue discs: the largest backlog of all queue discs together, in packets
+*   and bytes, with the per-packet overhead of the packet objects.
+*
+* Estimates count container payloads and node overheads; allocator slack is
+* not included, so they are lower bounds.
+*/
+
+#ifndef ABE_PROFILER_H
+#define ABE_PROFILER_H
+
+#include "ns3/core-module.h"
+#include "ns3/default-simulator-impl.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <string>
+#include <sys/resource.h>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+* @brief Wall-clock time spent in one event type or trace sink.
+*/
+struct ProfileEntry
+{
+    std::string name;        //!< Event type or sink name
+    uint64_t count{0};       //!< Number of calls
+    uint64_t nanoseconds{0}; //!< Wall-clock time of all calls
+};
+
+/**
+* @brief Default scheduler timing every event and the profiled trace sinks.
+*/
+class ProfilingSimulatorImpl : public DefaultSimulatorImpl
+{
+  public:
+    /**
+    * @brief Get the type ID.
+    * @return The object TypeId.
+    */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::ProfilingSimulatorImpl")
+                                .SetParent<DefaultSimulatorImpl>()
+                                .SetGroupName("Core")
+                                .AddConstructor<ProfilingSimulatorImpl>();
+        return tid;
+    }
+
+    /**
+    * @brief Make the simulator use this scheduler. Must be called before the
+    *        simulator is used.
+    * @return The scheduler.
+    */
+    static ProfilingSimulatorImpl* Enable()
+    {
+        GetTypeId();
+        GlobalValue::Bind("SimulatorImplementationType",
+                          StringValue("ns3::ProfilingSimulatorImpl"));
+        return PeekPointer(DynamicCast<ProfilingSimulatorImpl>(Simulator::GetImplementation()));
+    }
+
+    EventId Schedule(const Time& delay, EventImpl* event) override
+    {
+        return DefaultSimulatorImpl::Schedule(delay, Wrap(event));
+    }
+
+    void ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event) override
+    {
+        DefaultSimulatorImpl::ScheduleWithContext(context, delay, Wrap(event));
+    }
+
+    EventId ScheduleNow(EventImpl* event) override
+    {
+        return DefaultSimulatorImpl::ScheduleNow(Wrap(event));
+    }
+
+    EventId ScheduleDestroy(EventImpl* event) override
+    {
+        return DefaultSimulatorImpl::ScheduleDestroy(Wrap(event));
+    }
+
+    /**
+    * @brief Register a profiled trace sink.
+    * @param name The sink name.
+    * @return The sink id, for ProfileScope.
+    */
+    uint32_t AddSink(const std::string& name)
+    {
+        m_sinks.push_back(ProfileEntry{name});
+        return m_sinks.size() - 1;
+    }
+
+    /**
+    * @brief Add one call to a sink.
+    * @param sink The sink id.
+    * @param nanoseconds Wall-clock time of the call.
+    */
+    void RecordSink(uint32_t sink, uint64_t nanoseconds)
+    {
+        m_sinks[sink].count++;
+        m_sinks[sink].nanoseconds += nanoseconds;
+    }
+
+    /**
+    * @return Time per event type, in order of first use.
+    */
+    const std::vector<ProfileEntry>& GetEvents() const
+    {
+        return m_events;
+    }
+
+    /**
+    * @return Time per profiled sink, in order of registration.
+    */
+    const std::vector<ProfileEntry>& GetSinks() const
+    {
+        return m_sinks;
+    }
+
+  private:
+    /**
+    * @brief Event timing the event it wraps.
+    */
+    class TimedEvent : public EventImpl
+    {
+      public:
+        /**
+        * @brief Constructor
+        * @param profiler The scheduler.
+        * @param type The event type.
+        * @param event The wrapped event, now owned by this event.
+        */
+        TimedEvent(ProfilingSimulatorImpl* profiler, uint32_t type, EventImpl* event)
+            : m_profiler(profiler),
+              m_type(type),
+              m_event(event, false)
+        {
+        }
+
+      protected:
+        void Notify() override
+        {
+            auto start = std::chrono::steady_clock::now();
+            m_event->Invoke();
+            ProfileEntry& entry = m_profiler->m_events[m_type];
+            entry.count++;
+            entry.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count();
+        }
+
+      private:
+        ProfilingSimulatorImpl* m_profiler; //!< Scheduler
+        uint32_t m_type;                    //!< Event type
+        Ptr<EventImpl> m_event;             //!< Wrapped event
+    };
+
+    /**
+    * @brief Wrap an event in a timer of its type.
+    * @param event The event.
+    * @return The timed event.
+    */
+    EventImpl* Wrap(EventImpl* event)
+    {
+        auto [it, added] = m_eventTypes.emplace(std::type_index(typeid(*event)), m_events.size());
+        if (added)
+        {
+            m_events.push_back(ProfileEntry{Demangle(typeid(*event).name())});
+        }
+        return new TimedEvent(this, it->second, event);
+    }
+
+    /**
+    * @brief Readable name of a type.
+    * @param mangled The mangled type name.
+    * @return The demangled name, or the mangled one if it cannot be demangled.
+    */
+    static std::string Demangle(const char* mangled)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : mangled;
+        free(demangled);
+        return name;
+    }
+
+    std::unordered_map<std::type_index, uint32_t> m_eventTypes; //!< Event type by EventImpl type
+    std::vector<ProfileEntry> m_events;                          //!< Time per event type
+    std::vector<ProfileEntry> m_sinks;                           //!< Time per profiled sink
+};
+
+/**
+* @brief Times the scope it lives in as one call of a profiled sink.
+*
+* Without a profiler, nothing is timed.
+*/
+class ProfileScope
+{
+  public:
+    /**
+    * @brief Constructor
+    * @param profiler The profiling scheduler, or null.
+    * @param sink The sink id.
+    */
+    ProfileScope(ProfilingSimulatorImpl* profiler, uint32_t sink)
+        : m_profiler(profiler),
+          m_sink(sink)
+    {
+        if (m_profiler)
+        {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ProfileScope()
+    {
+        if (m_profiler)
+        {
+            m_profiler->RecordSink(m_sink,
+                                   std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now() - m_start)
+                                       .count());
+        }
+    }
+
+  private:
+    ProfilingSimulatorImpl* m_profiler;            //!< Profiling scheduler, or null
+    uint32_t m_sink;                               //!< Sink id
+    std::chrono::steady_clock::time_point m_start; //!< Start of the call
+};
+
+/**
+* @brief Times the per-packet FlowMonitor probes of a set of nodes as one
+*        profiled sink.
+*
+* Ipv4FlowProbe hooks the SendOutgoing and LocalDeliver traces of the IP layer,
+* and trace sinks run in the order they were connected. A sink connected before
+* FlowMonitor is installed starts a clock, and one connected after it stops the
+* clock, so the time in between is that of the FlowMonitor probes. Its drop
+* probes fire rarely and are not timed.
+*/
+class FlowProbeTimer
+{
+  public:
+    /**
+    * @brief Constructor
+    * @param profiler The profiling scheduler.
+    * @param sink The sink id.
+    */
+    FlowProbeTimer(ProfilingSimulatorImpl* profiler, uint32_t sink)
+        : m_profiler(profiler),
+          m_sink(sink)
+    {
+    }
+
+    /**
+    * @brief Start the clock on a set of nodes. Must be called before FlowMonitor
+    *        is installed on them.
+    * @param nodes The nodes.
+    */
+    void Before(NodeContainer nodes)
+    {
+        Connect(nodes, &FlowProbeTimer::Start);
+    }
+
+    /**
+    * @brief Stop the clock on a set of nodes. Must be called after FlowMonitor
+    *        is installed on them.
+    * @param nodes The nodes.
+    */
+    void After(NodeContainer nodes)
+    {
+        Connect(nodes, &FlowProbeTimer::Stop);
+    }
+
+  private:
+    /// Sink of the SendOutgoing and LocalDeliver traces
+    typedef void (*IpSink)(FlowProbeTimer*, const Ipv4Header&, Ptr<const Packet>, uint32_t);
+
+    /**
+    * @brief Connect a sink to the traces the FlowMonitor probes use.
+    * @param nodes The nodes.
+    * @param sink The sink.
+    */
+    void Connect(NodeContainer nodes, IpSink sink)
+    {
+        for (auto it = nodes.Begin(); it != nodes.End(); ++it)
+        {
+            Ptr<Ipv4L3Protocol> ipv4 = (*it)->GetObject<Ipv4L3Protocol>();
+            for (const char* trace : {"SendOutgoing", "LocalDeliver"})
+            {
+                ipv4->TraceConnectWithoutContext(trace, MakeBoundCallback(sink, this));
+            }
+        }
+    }
+
+    /**
+    * @brief Start of the probes of one packet.
+    * @param timer The timer.
+    */
+    static void Start(FlowProbeTimer* timer, const Ipv4Header&, Ptr<const Packet>, uint32_t)
+    {
+        timer->m_start = std::chrono::steady_clock::now();
+    }
+
+    /**
+    * @brief End of the probes of one packet.
+    * @param timer The timer.
+    */
+    static void Stop(FlowProbeTimer* timer, const Ipv4Header&, Ptr<const Packet>, uint32_t)
+    {
+        timer->m_profiler->RecordSink(timer->m_sink,
+                                      std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - timer->m_start)
+                                          .count());
+    }
+
+    ProfilingSimulatorImpl* m_profiler;            //!< Profiling scheduler
+    uint32_t m_sink;                               //!< Sink id
+    std::chrono::steady_clock::time_point m_start; //!< Start of the probes of a packet
+};
+
+/**
+* @brief Largest backlog of a set of queue discs, for their memory estimate.
+*/
+class QueueDiscMemoryProbe
+{
+  public:
+    /**
+    * @brief Count the backlog of a queue disc.
+    * @param qd The queue disc.
+    */
+    void Attach(Ptr<QueueDisc> qd)
+    {
+        qd->TraceConnectWithoutContext(
+            "PacketsInQueue",
+            MakeBoundCallback(&QueueDiscMemoryProbe::Backlog, &m_packets, &m_peakPackets));
+        qd->TraceConnectWithoutContext(
+            "BytesInQueue",
+            MakeBoundCallback(&QueueDiscMemoryProbe::Backlog, &m_bytes, &m_peakBytes));
+    }
+
+    /**
+    * @return Largest number of packets queued in all queue discs together.
+    */
+    uint64_t GetPeakPackets() const
+    {
+        return m_peakPackets;
+    }
+
+    /**
+    * @return Estimated memory held by the queued packets at the peak, in bytes.
+    */
+    uint64_t GetPeakMemory() const
+    {
+        // Packet, queue disc item and buffer bookkeeping per packet, plus the bytes
+        return m_peakPackets * (sizeof(Packet) + sizeof(Ipv4QueueDiscItem) + 64) + m_peakBytes;
+    }
+
+  private:
+    /**
+    * @brief PacketsInQueue and BytesInQueue trace sink.
+    * @param total The backlog of all queue discs.
+    * @param peak The largest backlog.
+    * @param oldval Old backlog of the queue disc.
+    * @param newval New backlog of the queue disc.
+    */
+    static void Backlog(uint64_t* total, uint64_t* peak, uint32_t oldval, uint32_t newval)
+    {
+        *total += newval;
+        *total -= oldval;
+        *peak = std::max(*peak, *total);
+    }
+
+    uint64_t m_packets{0};     //!< Packets queued
+    uint64_t m_bytes{0};       //!< Bytes queued
+    uint64_t m_peakPackets{0}; //!< Largest number of packets queued
+    uint64_t m_peakBytes{0};   //!< Largest number of bytes queued
+};
+
+/**
+* @brief Estimate the memory of the FlowMonitor state.
+* @param monitor The flow monitor.
+* @return Estimated bytes of flow statistics, probe statistics and classifier tables.
+*/
+inline uint64_t
+EstimateFlowMonitorMemory(Ptr<FlowMonitor> monitor)
+{
+    const uint64_t mapNode = 4 * sizeof(void*); // Color and links of a tree node
+    uint64_t bytes = 0;
+    for (const auto& [flowId, st] : monitor->GetFlowStats())
+    {
+        bytes += mapNode + sizeof(flowId) + sizeof(st);
+        for (const Histogram* h : {&st.delayHistogram,
+                                   &st.jitterHistogram,
+                                   &st.packetSizeHistogram,
+                                   &st.flowInterruptionsHistogram})
+        {
+            bytes += h->GetNBins() * sizeof(uint32_t);
+        }
+        bytes += st.packetsDropped.capacity() * sizeof(uint32_t) +
+                 st.bytesDropped.capacity() * sizeof(uint64_t);
+        // Classifier: five-tuple to flow id, and flow id to DSCP counts
+        bytes += 2 * mapNode + sizeof(Ipv4FlowClassifier::FiveTuple) + 2 * sizeof(FlowId);
+    }
+    for (const Ptr<FlowProbe>& probe : monitor->GetAllProbes())
+    {
+        for (const auto& [flowId, st] : probe->GetStats())
+        {
+            bytes += mapNode + sizeof(flowId) + sizeof(st) +
+                     st.packetsDropped.capacity() * sizeof(uint32_t) +
+                     st.bytesDropped.capacity() * sizeof(uint64_t);
+        }
+    }
+    return bytes;
+}
+
+/**
+* @return Peak resident set size of the process, in bytes.
+*/
+inline uint64_t
+PeakRss()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // ru_maxrss is in kB on Linux
+}
+
+} // namespace ns3
+
+#endif /* ABE_PROFILER_H */
@@ -0,0 +1,349 @@
+/*
+* Event-driven queue disc instrumentation for the ABE simulation
+*
+* QueueEventProbe replaces polling QueueDisc::GetCurrentSize() every 200 ms,
+* which misses every burst shorter than the polling period. It hooks the trace
+* sources of the queue disc and updates its counters on every event:
+*
+* - PacketsInQueue: queue length, integrated over time and maximum;
+* - Enqueue: packet arrivals;
+* - Mark: ECN marks (early and forced);
+* - DropBeforeEnqueue / DropAfterDequeue: drops, split into early drops
+*   decided by the AQM (RED and PIE "Unforced drop", CoDel "Target exceeded
+*   drop") and forced drops (above the RED maximum threshold or over the
+*   queue limit). Drops of the per-flow queues of FqCoDel and FqPIE are
+*   reported by the root queue disc with a prefix, and classified the same;
+* - SojournTime: per-packet queueing delay, counted in a histogram of fixed
+*   width bins up to a maximum, larger delays go to an overflow bin.
+*
+* Events are aggregated into fixed time bins. A bin is closed lazily by the
+* first event after its end (or by Advance()), and handed to a callback with
+* the time-averaged and maximum queue length and the event counts, so the
+* probe schedules no event of its own.
+*/
+
+#ifndef ABE_QUEUE_PROBE_H
+#define ABE_QUEUE_PROBE_H
+
+#include "ns3/core-module.h"
+#include "ns3/traffic-control-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+* @brief Queue length, ECN marks, drops and sojourn times of one queue disc.
+*/
+class QueueEventProbe
+{
+  public:
+    /**
+    * @brief Probe settings.
+    */
+    struct Options
+    {
+        Time binInterval{MilliSeconds(10)};        //!< Width of the time bins
+        Time sojournResolution{MicroSeconds(100)}; //!< Width of the sojourn histogram bins
+        Time sojournMax{Seconds(1)};               //!< Largest sojourn time resolved
+    };
+
+    /**
+    * @brief Events of one time bin.
+    */
+    struct Bin
+    {
+        Time start;           //!< Start of the bin
+        double avgPackets;    //!< Time-averaged queue length
+        uint32_t maxPackets;  //!< Largest queue length
+        uint32_t enqueues;    //!< Packets enqueued
+        uint32_t marks;       //!< Packets ECN-marked
+        uint32_t earlyDrops;  //!< Packets dropped early
+        uint32_t forcedDrops; //!< Packets dropped forcibly
+    };
+
+    /**
+    * @brief Constructor
+    * @param options The probe settings.
+    */
+    explicit QueueEventProbe(const Options& options)
+        : m_options(options),
+          m_sojourn(SojournBins(options), 0)
+    {
+    }
+
+    /**
+    * @brief Trace a queue disc, from now on.
+    * @param qd The queue disc.
+    */
+    void Attach(Ptr<QueueDisc> qd)
+    {
+        m_lastChange = Simulator::Now();
+        m_binEnd = m_lastChange + m_options.binInterval;
+        m_packets = qd->GetNPackets();
+        m_bin = Bin{m_lastChange, 0, m_packets, 0, 0, 0, 0};
+        qd->TraceConnectWithoutContext("PacketsInQueue",
+                                       MakeCallback(&QueueEventProbe::PacketsInQueue, this));
+        qd->TraceConnectWithoutContext("Enqueue", MakeCallback(&QueueEventProbe::Enqueue, this));
+        qd->TraceConnectWithoutContext("Mark", MakeCallback(&QueueEventProbe::Mark, this));
+        qd->TraceConnectWithoutContext("DropBeforeEnqueue",
+                                       MakeCallback(&QueueEventProbe::Drop, this));
+        qd->TraceConnectWithoutContext("DropAfterDequeue",
+                                       MakeCallback(&QueueEventProbe::Drop, this));
+        qd->TraceConnectWithoutContext("SojournTime",
+                                       MakeCallback(&QueueEventProbe::Sojourn, this));
+    }
+
+    /**
+    * @brief Set the function called with every closed time bin.
+    * @param callback The callback.
+    */
+    void SetBinCallback(Callback<void, const Bin&> callback)
+    {
+        m_binCallback = callback;
+    }
+
+    /**
+    * @brief Close every time bin that ends at or before a time.
+    * @param now The current simulation time.
+    */
+    void Advance(Time now)
+    {
+        while (now >= m_binEnd)
+        {
+            CloseBin();
+        }
+    }
+
+    /**
+    * @brief Restart the run totals and the sojourn histogram. The time bins and
+    *        the events of the bin being filled are kept.
+    */
+    void ResetTotals()
+    {
+        m_closedArea = 0;
+        m_closedTime = Seconds(0);
+        m_enqueues = 0;
+        m_marks = 0;
+        m_earlyDrops = 0;
+        m_forcedDrops = 0;
+        std::fill(m_sojourn.begin(), m_sojourn.end(), 0);
+    }
+
+    /**
+    * @return The queue length averaged over the closed time bins.
+    */
+    double GetAveragePackets() const
+    {
+        return m_closedTime.IsStrictlyPositive() ? m_closedArea / m_closedTime.GetSeconds() : 0;
+    }
+
+    /**
+    * @return ECN marks so far.
+    */
+    uint64_t GetMarks() const
+    {
+        return m_marks;
+    }
+
+    /**
+    * @return Early drops so far.
+    */
+    uint64_t GetEarlyDrops() const
+    {
+        return m_earlyDrops;
+    }
+
+    /**
+    * @return Forced drops so far.
+    */
+    uint64_t GetForcedDrops() const
+    {
+        return m_forcedDrops;
+    }
+
+    /**
+    * @return Packets enqueued so far.
+    */
+    uint64_t GetEnqueues() const
+    {
+        return m_enqueues;
+    }
+
+    /**
+    * @return The sojourn time histogram; bin i counts delays in
+    *         [i, i + 1) * sojournResolution, the last bin counts larger delays.
+    */
+    const std::vector<uint64_t>& GetSojournHistogram() const
+    {
+        return m_sojourn;
+    }
+
+    /**
+    * @param q The quantile, between 0 and 1.
+    * @return The upper edge of the histogram bin holding the quantile, 0
+    *         without samples, sojournMax if it is in the overflow bin.
+    */
+    Time GetSojournQuantile(double q) const
+    {
+        uint64_t total = 0;
+        for (uint64_t count : m_sojourn)
+        {
+            total += count;
+        }
+        if (total == 0)
+        {
+            return Seconds(0);
+        }
+        uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(q * total)), 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i + 1 < m_sojourn.size(); i++)
+        {
+            seen += m_sojourn[i];
+            if (seen >= rank)
+            {
+                return std::min(m_options.sojournResolution * static_cast<int64_t>(i + 1),
+                                m_options.sojournMax);
+            }
+        }
+        return m_options.sojournMax;
+    }
+
+  private:
+    /**
+    * @brief Check the probe settings.
+    * @param options The probe settings.
+    * @return The number of sojourn histogram bins, with the overflow bin.
+    */
+    static size_t SojournBins(const Options& options)
+    {
+        NS_ABORT_MSG_UNLESS(options.binInterval.IsStrictlyPositive() &&
+                                options.sojournResolution.IsStrictlyPositive(),
+                            "Queue probe intervals must be positive");
+        NS_ABORT_MSG_IF(options.sojournMax.IsNegative(),
+                        "The largest sojourn time must not be negative");
+        return options.sojournMax.GetTimeStep() / options.sojournResolution.GetTimeStep() + 2;
+    }
+
+  private:
+    /**
+    * @brief Close the current time bin and start the next one.
+    */
+    void CloseBin()
+    {
+        m_area += m_packets * (m_binEnd - m_lastChange).GetSeconds();
+        m_lastChange = m_binEnd;
+        m_bin.avgPackets = m_area / m_options.binInterval.GetSeconds();
+        m_closedArea += m_area;
+        m_closedTime += m_options.binInterval;
+        if (!m_binCallback.IsNull())
+        {
+            m_binCallback(m_bin);
+        }
+        m_area = 0;
+        m_bin = Bin{m_binEnd, 0, m_packets, 0, 0, 0, 0};
+        m_binEnd += m_options.binInterval;
+    }
+
+    /**
+    * @brief Close the bins that ended before the current event.
+    */
+    void CloseElapsedBins()
+    {
+        Advance(Simulator::Now());
+    }
+
+    /**
+    * @brief PacketsInQueue trace sink.
+    * @param oldValue Previous queue length.
+    * @param newValue New queue length.
+    */
+    void PacketsInQueue(uint32_t oldValue, uint32_t newValue)
+    {
+        CloseElapsedBins();
+        Time now = Simulator::Now();
+        m_area += m_packets * (now - m_lastChange).GetSeconds();
+        m_lastChange = now;
+        m_packets = newValue;
+        m_bin.maxPackets = std::max(m_bin.maxPackets, newValue);
+    }
+
+    /**
+    * @brief Enqueue trace sink.
+    * @param item The enqueued packet.
+    */
+    void Enqueue(Ptr<const QueueDiscItem> item)
+    {
+        CloseElapsedBins();
+        m_bin.enqueues++;
+        m_enqueues++;
+    }
+
+    /**
+    * @brief Mark trace sink.
+    * @param item The marked packet.
+    * @param reason The reason of the mark.
+    */
+    void Mark(Ptr<const QueueDiscItem> item, const char* reason)
+    {
+        CloseElapsedBins();
+        m_bin.marks++;
+        m_marks++;
+    }
+
+    /**
+    * @brief DropBeforeEnqueue and DropAfterDequeue trace sink.
+    * @param item The dropped packet.
+    * @param reason The reason of the drop.
+    */
+    void Drop(Ptr<const QueueDiscItem> item, const char* reason)
+    {
+        CloseElapsedBins();
+        if (strstr(reason, RedQueueDisc::UNFORCED_DROP) ||
+            strstr(reason, CoDelQueueDisc::TARGET_EXCEEDED_DROP))
+        {
+            m_bin.earlyDrops++;
+            m_earlyDrops++;
+        }
+        else
+        {
+            m_bin.forcedDrops++;
+            m_forcedDrops++;
+        }
+    }
+
+    /**
+    * @brief SojournTime trace sink.
+    * @param sojourn Time the dequeued packet spent in the queue disc.
+    */
+    void Sojourn(Time sojourn)
+    {
+        size_t bin = std::min<size_t>(sojourn.GetTimeStep() /
+                                          m_options.sojournResolution.GetTimeStep(),
+                                      m_sojourn.size() - 1);
+        m_sojourn[bin]++;
+    }
+
+    Options m_options;                        //!< Probe settings
+    Callback<void, const Bin&> m_binCallback; //!< Called with every closed bin
+    Bin m_bin{};                              //!< Bin being filled
+    Time m_binEnd;                            //!< End of the bin being filled
+    Time m_lastChange;                        //!< Time of the last queue length change
+    uint32_t m_packets{0};                    //!< Current queue length
+    double m_area{0};                         //!< Queue length integral over the bin
+    double m_closedArea{0};                   //!< Queue length integral over closed bins
+    Time m_closedTime;                        //!< Duration of the closed bins
+    uint64_t m_enqueues{0};                   //!< Total packets enqueued
+    uint64_t m_marks{0};                      //!< Total ECN marks
+    uint64_t m_earlyDrops{0};                 //!< Total early drops
+    uint64_t m_forcedDrops{0};                //!< Total forced drops
+    std::vector<uint64_t> m_sojourn;          //!< Sojourn time histogram
+};
+
+} // namespace ns3
+
+#endif /* ABE_QUEUE_PROBE_H */
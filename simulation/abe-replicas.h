@@ -0,0 +1,133 @@
+/*
+* Seeded replicas and content-addressed output directories for the ABE simulation
+*
+* One run is one random sample. With a range of run numbers, the simulation
+* forks one child process per replica (see ForkBranches() in abe-snapshot.h),
+* each with the same RNG seed and its own run number (ns-3 RngRun), so the
+* replicas use independent random streams and are reproducible one by one.
+*
+* Output directories are named by a hash of the configuration instead of the
+* wall clock time:
+*
+* - the configuration is the command line, with the arguments that only
+*   decide where and how fast the run executes (output directory, number of
+*   parallel jobs) and the RNG seed and run left out, sorted by name;
+* - a run directory is the FNV-1a hash of the configuration, the seed and the
+*   run number, so two different runs never write to the same directory and
+*   the same run always writes to the same one.
+*
+* Note: This header has no ns-3 dependency.
+*/
+
+#ifndef ABE_REPLICAS_H
+#define ABE_REPLICAS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+* @brief Parse a range of run numbers.
+* @param range "N" for one run, "A..B" for runs A to B.
+* @param first Set to the first run.
+* @param last Set to the last run.
+* @return False if the range is malformed or empty.
+*/
+inline bool
+ParseRunRange(const std::string& range, uint32_t& first, uint32_t& last)
+{
+    size_t dots = range.find("..");
+    try
+    {
+        size_t end;
+        first = std::stoul(range.substr(0, dots), &end);
+        if (end != range.substr(0, dots).size())
+        {
+            return false;
+        }
+        last = first;
+        if (dots != std::string::npos)
+        {
+            last = std::stoul(range.substr(dots + 2), &end);
+            if (end != range.size() - dots - 2)
+            {
+                return false;
+            }
+        }
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    return first >= 1 && first <= last;
+}
+
+/**
+* @brief Get the configuration arguments of a command line.
+* @param argc Number of arguments.
+* @param argv The arguments, argv[0] being the program.
+* @param excluded Names of the arguments that are not part of the configuration.
+* @return The "--name=value" arguments, without excluded names, sorted.
+*/
+inline std::vector<std::string>
+ConfigArguments(int argc, char* argv[], const std::vector<std::string>& excluded)
+{
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        size_t start = std::min(arg.find_first_not_of('-'), arg.size());
+        std::string name = arg.substr(start, arg.find('=') - start);
+        if (std::find(excluded.begin(), excluded.end(), name) == excluded.end())
+        {
+            args.push_back(arg);
+        }
+    }
+    std::sort(args.begin(), args.end());
+    return args;
+}
+
+/**
+* @brief Hash a configuration, with FNV-1a.
+* @param args The configuration arguments.
+* @param suffix Appended to the configuration, e.g. the seed and run.
+* @return The hash, as 16 hex digits.
+*/
+inline std::string
+HashConfig(const std::vector<std::string>& args, const std::string& suffix = "")
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto add = [&hash](const std::string& s) {
+        for (unsigned char c : s)
+        {
+            hash = (hash ^ c) * 0x100000001b3ULL;
+        }
+        hash = (hash ^ '\n') * 0x100000001b3ULL;
+    };
+    for (const std::string& arg : args)
+    {
+        add(arg);
+    }
+    add(suffix);
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+/**
+* @brief Get the directory name of one run.
+* @param args The configuration arguments.
+* @param seed The RNG seed.
+* @param run The RNG run number.
+* @return The content-addressed directory name.
+*/
+inline std::string
+RunDirectoryName(const std::vector<std::string>& args, uint32_t seed, uint64_t run)
+{
+    return HashConfig(args, "seed=" + std::to_string(seed) + " run=" + std::to_string(run));
+}
+
+#endif /* ABE_REPLICAS_H */
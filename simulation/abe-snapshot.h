@@ -0,0 +1,152 @@
+/*
+* Snapshot branches for the ABE simulation
+*
+* Instead of serializing the simulator, the process itself is the snapshot:
+* once the warm-up has run up to the snapshot time, the simulation forks one
+* child process per branch. Every child starts from an exact copy of the
+* parent's memory (event queue, sockets, TcpSocketState, RED queues, random
+* number streams, counters), applies its own parameters and runs on to the
+* stop time. The pages are shared copy-on-write, so a branch costs only the
+* memory it changes.
+*
+* Branch file, one branch per line, "#" starts a comment:
+*
+*   <name> <key>=<value> [<key>=<value> ...]
+*
+* Note: This header has no ns-3 dependency. Open files and pcap writers are
+*       inherited by every branch, so they must be closed before forking.
+*/
+
+#ifndef ABE_SNAPSHOT_H
+#define ABE_SNAPSHOT_H
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/**
+* @brief One branch forked from the snapshot.
+*/
+struct SnapshotBranch
+{
+    std::string name; //!< Branch name, also names its output directory
+    std::vector<std::pair<std::string, std::string>> params; //!< Parameters to apply
+    pid_t pid{-1};    //!< Child process id while running
+    int status{-1};   //!< Exit status, -1 if the branch did not finish
+};
+
+/**
+* @brief Read a branch file.
+* @param path The file path.
+* @param error Set to a description of the first error, if any.
+* @return The branches, in file order.
+*/
+inline std::vector<SnapshotBranch>
+ReadBranches(const std::string& path, std::string& error)
+{
+    std::vector<SnapshotBranch> branches;
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        error = "cannot open " + path;
+        return branches;
+    }
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        SnapshotBranch branch;
+        if (!(fields >> branch.name))
+        {
+            continue;
+        }
+        std::string param;
+        while (fields >> param)
+        {
+            size_t eq = param.find('=');
+            if (eq == std::string::npos || eq == 0)
+            {
+                error = path + ":" + std::to_string(lineNumber) + ": expected key=value, got " +
+                        param;
+                return {};
+            }
+            branch.params.emplace_back(param.substr(0, eq), param.substr(eq + 1));
+        }
+        branches.push_back(branch);
+    }
+    if (branches.empty())
+    {
+        error = path + " defines no branch";
+    }
+    return branches;
+}
+
+/**
+* @brief Fork one child process per branch, running at most jobs at a time.
+*
+* In a child, returns the index of its branch; the child is expected to run
+* the branch and exit. In the parent, returns -1 once every branch has
+* exited, with the exit status of every branch stored in branches.
+*
+* @param branches The branches.
+* @param jobs Maximum number of branches running at the same time.
+* @return The branch index in a child, -1 in the parent.
+*/
+inline int
+ForkBranches(std::vector<SnapshotBranch>& branches, uint32_t jobs)
+{
+    size_t next = 0;
+    uint32_t running = 0;
+    while (next < branches.size() || running > 0)
+    {
+        while (running < jobs && next < branches.size())
+        {
+            // Buffered output would otherwise be written once per child
+            fflush(nullptr);
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                return static_cast<int>(next);
+            }
+            branches[next].pid = pid;
+            if (pid > 0)
+            {
+                running++;
+            }
+            next++;
+        }
+        if (running == 0)
+        {
+            continue;
+        }
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            break;
+        }
+        for (SnapshotBranch& branch : branches)
+        {
+            if (branch.pid == pid)
+            {
+                branch.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+                branch.pid = -1;
+                running--;
+            }
+        }
+    }
+    return -1;
+}
+
+#endif /* ABE_SNAPSHOT_H */
@@ -0,0 +1,409 @@
+/*
+* Online statistics for the ABE simulation
+*
+* The simulation feeds every sample of a metric (queue delay, queue length,
+* congestion window, goodput) into an OnlineSummary while it runs, instead of
+* only writing it to a trace file for later analysis:
+*
+* - OnlineStats: count, mean and variance (Welford's algorithm), min and max,
+*   in constant memory and numerically stable over millions of samples.
+* - LogHistogram: log-linear histogram in the style of HDR histograms. Every
+*   power of two above the lowest value is split into 2^subBucketBits linear
+*   buckets, so any quantile is known within a relative error of
+*   2^-subBucketBits, with a few KB of memory whatever the number of samples.
+*
+* WriteSummaryJson() writes the configuration of a run and the summaries of
+* all metrics as one compact JSON object. ConfidenceInterval95() turns the
+* results of independent replicas of a run into a Student t confidence
+* interval of their mean.
+*
+* Note: This header has no ns-3 dependency.
+*/
+
+#ifndef ABE_STATS_H
+#define ABE_STATS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+* @brief Running count, mean, variance, min and max of a sample stream.
+*/
+class OnlineStats
+{
+  public:
+    /**
+    * @brief Add one sample.
+    * @param x The sample.
+    */
+    void Add(double x)
+    {
+        m_count++;
+        double delta = x - m_mean;
+        m_mean += delta / m_count;
+        m_m2 += delta * (x - m_mean);
+        m_min = std::min(m_min, x);
+        m_max = std::max(m_max, x);
+    }
+
+    /**
+    * @return The number of samples.
+    */
+    uint64_t GetCount() const
+    {
+        return m_count;
+    }
+
+    /**
+    * @return The mean, 0 without samples.
+    */
+    double GetMean() const
+    {
+        return m_mean;
+    }
+
+    /**
+    * @return The sample variance, 0 with fewer than two samples.
+    */
+    double GetVariance() const
+    {
+        return m_count > 1 ? m_m2 / (m_count - 1) : 0;
+    }
+
+    /**
+    * @return The sample standard deviation.
+    */
+    double GetStddev() const
+    {
+        return std::sqrt(GetVariance());
+    }
+
+    /**
+    * @return The smallest sample, 0 without samples.
+    */
+    double GetMin() const
+    {
+        return m_count ? m_min : 0;
+    }
+
+    /**
+    * @return The largest sample, 0 without samples.
+    */
+    double GetMax() const
+    {
+        return m_count ? m_max : 0;
+    }
+
+  private:
+    uint64_t m_count{0}; //!< Number of samples
+    double m_mean{0};    //!< Running mean
+    double m_m2{0};      //!< Sum of squared differences from the mean
+    double m_min{std::numeric_limits<double>::infinity()};  //!< Smallest sample
+    double m_max{-std::numeric_limits<double>::infinity()}; //!< Largest sample
+};
+
+/**
+* @brief Two-sided 95% quantile of the Student t distribution.
+* @param df Degrees of freedom, at least 1.
+* @return The 0.975 quantile.
+*/
+inline double
+StudentT975(uint64_t df)
+{
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                   2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                   2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                   2.060,  2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df == 0)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (df <= 30)
+    {
+        return table[df - 1];
+    }
+    // Cornish-Fisher expansion around the normal quantile, within 1e-3 above 30
+    double z = 1.959964;
+    double n = static_cast<double>(df);
+    return z + (z * z * z + z) / (4 * n) +
+           (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * n * n);
+}
+
+/**
+* @brief Confidence interval of a mean.
+*/
+struct ConfidenceInterval
+{
+    uint64_t count{0};    //!< Number of samples
+    double mean{0};       //!< Sample mean
+    double halfWidth{0};  //!< Half width, infinite with fewer than two samples
+};
+
+/**
+* @brief Get the 95% confidence interval of the mean of independent samples.
+* @param stats The samples, e.g. one result per replica.
+* @return The interval mean +- halfWidth.
+*/
+inline ConfidenceInterval
+ConfidenceInterval95(const OnlineStats& stats)
+{
+    ConfidenceInterval ci;
+    ci.count = stats.GetCount();
+    ci.mean = stats.GetMean();
+    ci.halfWidth = ci.count > 1
+                       ? StudentT975(ci.count - 1) * stats.GetStddev() / std::sqrt(ci.count)
+                       : std::numeric_limits<double>::infinity();
+    return ci;
+}
+
+/**
+* @brief Log-linear histogram of non-negative samples with bounded relative error.
+*/
+class LogHistogram
+{
+  public:
+    /**
+    * @brief Constructor
+    * @param lowest Samples below this value are counted as zero.
+    * @param subBucketBits Linear buckets per power of two, as a power of two.
+    */
+    explicit LogHistogram(double lowest = 1e-3, uint32_t subBucketBits = 7)
+        : m_lowest(lowest),
+          m_subBuckets(1U << subBucketBits)
+    {
+    }
+
+    /**
+    * @brief Add one sample.
+    * @param x The sample, negative values are counted as zero.
+    */
+    void Add(double x)
+    {
+        size_t index = Index(x);
+        if (index >= m_counts.size())
+        {
+            m_counts.resize(index + 1, 0);
+        }
+        m_counts[index]++;
+        m_total++;
+    }
+
+    /**
+    * @brief Remove all samples.
+    */
+    void Clear()
+    {
+        m_counts.clear();
+        m_total = 0;
+    }
+
+    /**
+    * @return The number of samples.
+    */
+    uint64_t GetCount() const
+    {
+        return m_total;
+    }
+
+    /**
+    * @brief Get a quantile.
+    * @param q The quantile, between 0 and 1.
+    * @return The middle of the bucket holding the quantile, 0 without samples.
+    */
+    double GetQuantile(double q) const
+    {
+        if (m_total == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * m_total));
+        rank = std::max<uint64_t>(rank, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < m_counts.size(); i++)
+        {
+            seen += m_counts[i];
+            if (seen >= rank)
+            {
+                return BucketMiddle(i);
+            }
+        }
+        return BucketMiddle(m_counts.size() - 1);
+    }
+
+  private:
+    /**
+    * @param x The sample.
+    * @return The index of the bucket counting x; bucket 0 counts zero.
+    */
+    size_t Index(double x) const
+    {
+        if (!(x >= m_lowest))
+        {
+            return 0;
+        }
+        int exponent;
+        double mantissa = std::frexp(x / m_lowest, &exponent); // in [0.5, 1), exponent >= 1
+        auto sub = static_cast<size_t>((mantissa - 0.5) * 2 * m_subBuckets);
+        return 1 + static_cast<size_t>(exponent - 1) * m_subBuckets +
+               std::min<size_t>(sub, m_subBuckets - 1);
+    }
+
+    /**
+    * @param index The bucket index.
+    * @return The value in the middle of the bucket.
+    */
+    double BucketMiddle(size_t index) const
+    {
+        if (index == 0)
+        {
+            return 0;
+        }
+        size_t exponent = (index - 1) / m_subBuckets;
+        size_t sub = (index - 1) % m_subBuckets;
+        double base = m_lowest * std::ldexp(1.0, static_cast<int>(exponent));
+        return base * (1 + (sub + 0.5) / m_subBuckets);
+    }
+
+    double m_lowest;                //!< Smallest value not counted as zero
+    uint32_t m_subBuckets;          //!< Linear buckets per power of two
+    std::vector<uint64_t> m_counts; //!< Sample count per bucket
+    uint64_t m_total{0};            //!< Number of samples
+};
+
+/**
+* @brief Moments and quantiles of one metric.
+*/
+class OnlineSummary
+{
+  public:
+    /**
+    * @brief Constructor
+    * @param lowest Smallest value resolved by the histogram.
+    */
+    explicit OnlineSummary(double lowest = 1e-3)
+        : m_histogram(lowest)
+    {
+    }
+
+    /**
+    * @brief Add one sample.
+    * @param x The sample.
+    */
+    void Add(double x)
+    {
+        m_stats.Add(x);
+        m_histogram.Add(x);
+    }
+
+    /**
+    * @brief Remove all samples.
+    */
+    void Clear()
+    {
+        m_stats = OnlineStats();
+        m_histogram.Clear();
+    }
+
+    /**
+    * @return The moments of the samples.
+    */
+    const OnlineStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+    /**
+    * @param q The quantile, between 0 and 1.
+    * @return The quantile, clamped to the range of the samples.
+    */
+    double GetQuantile(double q) const
+    {
+        return std::clamp(m_histogram.GetQuantile(q), m_stats.GetMin(), m_stats.GetMax());
+    }
+
+  private:
+    OnlineStats m_stats;      //!< Moments
+    LogHistogram m_histogram; //!< Quantiles
+};
+
+/**
+* @brief Quote a string for JSON.
+* @param value The string.
+* @return The JSON string.
+*/
+inline std::string
+JsonString(const std::string& value)
+{
+    std::string quoted = "\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/**
+* @brief Format a value for JSON, as a number if it parses as one.
+* @param value The value.
+* @return The JSON value.
+*/
+inline std::string
+JsonValue(const std::string& value)
+{
+    static const std::regex number(R"(-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?)");
+    return std::regex_match(value, number) ? value : JsonString(value);
+}
+
+/**
+* @brief Write the summary of one run as JSON.
+*
+* The output is {"run": {key: value, ...}, "stats": {metric: {"count", "mean",
+* "stddev", "min", "max", "p50", "p90", "p99"}, ...}}.
+*
+* @param path The output file.
+* @param run The configuration and results of the run, in output order.
+* @param stats The metric summaries, in output order.
+* @return False if the file cannot be written.
+*/
+inline bool
+WriteSummaryJson(const std::string& path,
+                 const std::vector<std::pair<std::string, std::string>>& run,
+                 const std::vector<std::pair<std::string, const OnlineSummary*>>& stats)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    out.precision(10);
+    out << "{\"run\":{";
+    for (size_t i = 0; i < run.size(); i++)
+    {
+        out << (i ? "," : "") << JsonString(run[i].first) << ":" << JsonValue(run[i].second);
+    }
+    out << "},\"stats\":{";
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        const OnlineSummary& s = *stats[i].second;
+        out << (i ? "," : "") << JsonString(stats[i].first) << ":{"
+            << "\"count\":" << s.GetStats().GetCount() << ",\"mean\":" << s.GetStats().GetMean()
+            << ",\"stddev\":" << s.GetStats().GetStddev() << ",\"min\":" << s.GetStats().GetMin()
+            << ",\"max\":" << s.GetStats().GetMax() << ",\"p50\":" << s.GetQuantile(0.5)
+            << ",\"p90\":" << s.GetQuantile(0.9) << ",\"p99\":" << s.GetQuantile(0.99) << "}";
+    }
+    out << "}}\n";
+    return out.good();
+}
+
+#endif /* ABE_STATS_H */
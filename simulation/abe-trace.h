@@ -0,0 +1,381 @@
+/*
+* Binary columnar trace files for the ABE simulation
+*
+* Trace samples (time, value, flow id) are buffered in memory and written to
+* disk one fixed-size block at a time, instead of one formatted text line per
+* sample. Every block stores its samples column by column:
+*
+*   file header  | magic "ABETRACE", version, block capacity, time format
+*   block 0      | count, int64 timeNs[capacity], double value[capacity],
+*                |        uint32 flowId[capacity]
+*   block 1 ...
+*
+* Blocks have a fixed size, so the file can be memory-mapped and block i is
+* found at a constant offset. Only the first "count" entries of a block are
+* valid (the last block is usually partial). Values are stored in host byte
+* order.
+*
+* The same writer can also produce the legacy text format ("time value" per
+* line, optionally prefixed by the flow id), without flushing the stream on
+* every sample. TraceReader and
+* ABE_TraceConvert.cc turn binary files back into that text format.
+*
+* Note: This header has no ns-3 dependency, so that ABE_TraceConvert.cc can be
+*       built on its own.
+*/
+
+#ifndef ABE_TRACE_H
+#define ABE_TRACE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+* @brief How the time column is printed in the text format.
+*/
+enum TraceTimeFormat : uint32_t
+{
+    TRACE_TIME_SECONDS = 0, //!< Plain seconds, as Simulator::Now().GetSeconds()
+    TRACE_TIME_NS3 = 1,     //!< ns-3 Time stream output, e.g. "+2e+08ns"
+};
+
+/**
+* @brief Header at the start of every binary trace file.
+*/
+struct TraceFileHeader
+{
+    char magic[8];          //!< "ABETRACE"
+    uint32_t version;       //!< Format version
+    uint32_t blockCapacity; //!< Number of samples per block
+    uint32_t timeFormat;    //!< TraceTimeFormat of the time column
+    uint32_t reserved[3];   //!< Padding, always zero
+};
+
+static_assert(sizeof(TraceFileHeader) == 32, "Trace file header must be 32 bytes");
+
+/// Current binary trace format version
+static const uint32_t TRACE_FORMAT_VERSION = 1;
+
+/// Default number of samples per block
+static const uint32_t TRACE_DEFAULT_BLOCK_CAPACITY = 8192;
+
+/**
+* @brief Size on disk of one block.
+* @param capacity The number of samples per block.
+* @return The block size in bytes.
+*/
+inline size_t
+TraceBlockBytes(uint32_t capacity)
+{
+    size_t bytes =
+        sizeof(uint64_t) + capacity * (sizeof(int64_t) + sizeof(double) + sizeof(uint32_t));
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+/**
+* @brief Print one sample in the legacy text format.
+* @param file The output file.
+* @param format The time format.
+* @param timeNs The sample time in nanoseconds.
+* @param value The sample value.
+*/
+inline void
+WriteTraceText(FILE* file, uint32_t format, int64_t timeNs, double value)
+{
+    // %g matches the default precision of std::ostream used by the old tracers
+    if (format == TRACE_TIME_NS3)
+    {
+        fprintf(file, "%+gns %g\n", static_cast<double>(timeNs), value);
+    }
+    else
+    {
+        fprintf(file, "%g %g\n", timeNs / 1e9, value);
+    }
+}
+
+/**
+* @brief Buffered writer for one trace, in binary columnar or text format.
+*/
+class TraceWriter
+{
+  public:
+    TraceWriter() = default;
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    ~TraceWriter()
+    {
+        Close();
+    }
+
+    /**
+    * @brief Open the trace file, truncating it.
+    * @param path The file path.
+    * @param binary Write the binary columnar format if true, text otherwise.
+    * @param timeFormat The time format used by the text representation.
+    * @param withFlowId Prefix every text line with the flow id.
+    * @param blockCapacity The number of samples buffered per block.
+    * @return True if the file was opened.
+    */
+    bool Open(const std::string& path,
+              bool binary,
+              TraceTimeFormat timeFormat,
+              bool withFlowId = false,
+              uint32_t blockCapacity = TRACE_DEFAULT_BLOCK_CAPACITY)
+    {
+        Close();
+        m_file = fopen(path.c_str(), "wb");
+        if (!m_file)
+        {
+            return false;
+        }
+        m_binary = binary;
+        m_timeFormat = timeFormat;
+        m_withFlowId = withFlowId;
+        m_capacity = blockCapacity;
+        m_count = 0;
+        if (m_binary)
+        {
+            TraceFileHeader header{};
+            memcpy(header.magic, "ABETRACE", sizeof(header.magic));
+            header.version = TRACE_FORMAT_VERSION;
+            header.blockCapacity = m_capacity;
+            header.timeFormat = m_timeFormat;
+            fwrite(&header, sizeof(header), 1, m_file);
+            m_block.assign(TraceBlockBytes(m_capacity), 0);
+        }
+        else
+        {
+            // Large stdio buffer instead of one flush per line
+            setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+        }
+        return true;
+    }
+
+    /**
+    * @return True if the trace file is open.
+    */
+    bool IsOpen() const
+    {
+        return m_file != nullptr;
+    }
+
+    /**
+    * @brief Append one sample.
+    * @param timeNs The sample time in nanoseconds.
+    * @param value The sample value.
+    * @param flowId The flow the sample belongs to.
+    */
+    void Write(int64_t timeNs, double value, uint32_t flowId = 0)
+    {
+        if (!m_binary)
+        {
+            if (m_withFlowId)
+            {
+                fprintf(m_file, "%u ", flowId);
+            }
+            WriteTraceText(m_file, m_timeFormat, timeNs, value);
+            return;
+        }
+        TimeColumn()[m_count] = timeNs;
+        ValueColumn()[m_count] = value;
+        FlowColumn()[m_count] = flowId;
+        if (++m_count == m_capacity)
+        {
+            FlushBlock();
+        }
+    }
+
+    /**
+    * @brief Write any buffered samples and close the file.
+    */
+    void Close()
+    {
+        if (!m_file)
+        {
+            return;
+        }
+        if (m_binary && m_count > 0)
+        {
+            FlushBlock();
+        }
+        fclose(m_file);
+        m_file = nullptr;
+    }
+
+  private:
+    /**
+    * @return The time column of the block being filled.
+    */
+    int64_t* TimeColumn()
+    {
+        return reinterpret_cast<int64_t*>(m_block.data() + sizeof(uint64_t));
+    }
+
+    /**
+    * @return The value column of the block being filled.
+    */
+    double* ValueColumn()
+    {
+        return reinterpret_cast<double*>(m_block.data() + sizeof(uint64_t) +
+                                         m_capacity * sizeof(int64_t));
+    }
+
+    /**
+    * @return The flow id column of the block being filled.
+    */
+    uint32_t* FlowColumn()
+    {
+        return reinterpret_cast<uint32_t*>(m_block.data() + sizeof(uint64_t) +
+                                           m_capacity * (sizeof(int64_t) + sizeof(double)));
+    }
+
+    /**
+    * @brief Write the current block, padded to full size, and start a new one.
+    */
+    void FlushBlock()
+    {
+        uint64_t count = m_count;
+        memcpy(m_block.data(), &count, sizeof(count));
+        fwrite(m_block.data(), m_block.size(), 1, m_file);
+        m_count = 0;
+    }
+
+    FILE* m_file{nullptr};                             //!< Output file
+    bool m_binary{true};                               //!< Binary columnar or text output
+    TraceTimeFormat m_timeFormat{TRACE_TIME_SECONDS};  //!< Time format of the text output
+    bool m_withFlowId{false};                          //!< Flow id column in the text output
+    uint32_t m_capacity{TRACE_DEFAULT_BLOCK_CAPACITY}; //!< Samples per block
+    uint32_t m_count{0};                               //!< Samples in the current block
+    std::vector<uint8_t> m_block;                      //!< Block being filled
+};
+
+/**
+* @brief Memory-mapped reader for binary trace files.
+*/
+class TraceReader
+{
+  public:
+    /**
+    * @brief Column view of one block.
+    */
+    struct Block
+    {
+        uint32_t count;         //!< Number of valid samples
+        const int64_t* timeNs;  //!< Sample times in nanoseconds
+        const double* value;    //!< Sample values
+        const uint32_t* flowId; //!< Flow ids
+    };
+
+    TraceReader() = default;
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    ~TraceReader()
+    {
+        Close();
+    }
+
+    /**
+    * @brief Map a binary trace file.
+    * @param path The file path.
+    * @return False if the file cannot be mapped or is not a trace file.
+    */
+    bool Open(const std::string& path)
+    {
+        Close();
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TraceFileHeader))
+        {
+            close(fd);
+            return false;
+        }
+        m_size = st.st_size;
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+        m_data = static_cast<const uint8_t*>(data);
+        memcpy(&m_header, m_data, sizeof(m_header));
+        if (memcmp(m_header.magic, "ABETRACE", sizeof(m_header.magic)) != 0 ||
+            m_header.version != TRACE_FORMAT_VERSION || m_header.blockCapacity == 0)
+        {
+            Close();
+            return false;
+        }
+        m_blockBytes = TraceBlockBytes(m_header.blockCapacity);
+        return true;
+    }
+
+    /**
+    * @brief Unmap the file.
+    */
+    void Close()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+            m_data = nullptr;
+        }
+    }
+
+    /**
+    * @return The file header.
+    */
+    const TraceFileHeader& GetHeader() const
+    {
+        return m_header;
+    }
+
+    /**
+    * @return The number of complete blocks in the file.
+    */
+    size_t GetBlockCount() const
+    {
+        return m_data ? (m_size - sizeof(TraceFileHeader)) / m_blockBytes : 0;
+    }
+
+    /**
+    * @brief Get the columns of one block.
+    * @param i The block index.
+    * @return The block view.
+    */
+    Block GetBlock(size_t i) const
+    {
+        const uint8_t* base = m_data + sizeof(TraceFileHeader) + i * m_blockBytes;
+        uint32_t capacity = m_header.blockCapacity;
+        uint64_t count;
+        memcpy(&count, base, sizeof(count));
+        Block block;
+        block.count = static_cast<uint32_t>(count < capacity ? count : capacity);
+        block.timeNs = reinterpret_cast<const int64_t*>(base + sizeof(uint64_t));
+        block.value =
+            reinterpret_cast<const double*>(base + sizeof(uint64_t) + capacity * sizeof(int64_t));
+        block.flowId = reinterpret_cast<const uint32_t*>(
+            base + sizeof(uint64_t) + capacity * (sizeof(int64_t) + sizeof(double)));
+        return block;
+    }
+
+  private:
+    const uint8_t* m_data{nullptr}; //!< Mapped file
+    size_t m_size{0};               //!< Mapped size
+    size_t m_blockBytes{0};         //!< Size of one block
+    TraceFileHeader m_header{};     //!< Copy of the file header
+};
+
+#endif /* ABE_TRACE_H */
@@ -0,0 +1,629 @@
+/*
+* Short-flow workload generator for the ABE simulation
+*
+* WorkloadGenerator offers finite flows (messages) on top of, or instead of,
+* the infinite bulk flows, to measure flow completion times (FCT):
+*
+* - Flow sizes are drawn from an empirical CDF file, one "bytes probability"
+*   line per point, interpolated linearly between the points (FlowSizeCdf).
+* - Every sender starts flows as a Poisson process. The arrival rate makes the
+*   offered load a given fraction of the bottleneck rate, split evenly over
+*   the senders.
+* - A sender carries its flows over a pool of persistent TCP connections to
+*   its receiver, opened on demand up to the pool size, so no application or
+*   socket is created per flow. A flow uses an idle connection, or waits for
+*   one in the sender's backlog; the connection is idle again as soon as the
+*   receiver has the whole flow.
+* - The FCT of a flow runs from its arrival, backlog included, to the arrival
+*   of its last byte at the receiver, which is counted per connection from the
+*   sink sockets. Only a small record is kept per flow.
+* - A connection that fails, in the handshake or later with an error, leaves
+*   the pool, so a new one can take its place. The flow it carried is marked
+*   failed and has no FCT.
+*
+* The sender reacts to the receiver side directly, so both ends of a flow
+* must run in the same process (no distributed runs).
+*/
+
+#ifndef ABE_WORKLOAD_H
+#define ABE_WORKLOAD_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+* @brief Empirical flow size distribution.
+*/
+class FlowSizeCdf
+{
+  public:
+    /**
+    * @brief Load a CDF file.
+    *
+    * Every line holds a flow size in bytes and the probability that a flow is
+    * at most that large, both non-decreasing, the last probability being 1.
+    * Empty lines and "#" comments are skipped.
+    *
+    * @param path The CDF file path.
+    * @return False if the file cannot be read or is not a CDF.
+    */
+    bool Load(const std::string& path)
+    {
+        std::ifstream in(path);
+        if (!in.is_open())
+        {
+            return false;
+        }
+        m_sizes.clear();
+        m_probabilities.clear();
+        std::string line;
+        while (std::getline(in, line))
+        {
+            std::stringstream fields(line.substr(0, line.find('#')));
+            double size;
+            double probability;
+            if (!(fields >> size))
+            {
+                continue;
+            }
+            if (!(fields >> probability) || size < 0 || probability < 0 || probability > 1 ||
+                (!m_sizes.empty() &&
+                 (size < m_sizes.back() || probability < m_probabilities.back())))
+            {
+                return false;
+            }
+            m_sizes.push_back(size);
+            m_probabilities.push_back(probability);
+        }
+        return !m_sizes.empty() && m_probabilities.back() == 1;
+    }
+
+    /**
+    * @brief Draw a flow size.
+    * @param u A uniform random number in [0, 1).
+    * @return The flow size in bytes, at least 1.
+    */
+    uint64_t Sample(double u) const
+    {
+        size_t i = std::lower_bound(m_probabilities.begin(), m_probabilities.end(), u) -
+                   m_probabilities.begin();
+        double size = m_sizes[i];
+        if (i > 0 && m_probabilities[i] > m_probabilities[i - 1])
+        {
+            double f = (u - m_probabilities[i - 1]) / (m_probabilities[i] - m_probabilities[i - 1]);
+            size = m_sizes[i - 1] + f * (m_sizes[i] - m_sizes[i - 1]);
+        }
+        return std::max<uint64_t>(1, static_cast<uint64_t>(size + 0.5));
+    }
+
+    /**
+    * @return Mean flow size in bytes.
+    */
+    double GetMean() const
+    {
+        double mean = m_sizes[0] * m_probabilities[0];
+        for (size_t i = 1; i < m_sizes.size(); i++)
+        {
+            mean += (m_probabilities[i] - m_probabilities[i - 1]) *
+                    (m_sizes[i] + m_sizes[i - 1]) / 2;
+        }
+        return mean;
+    }
+
+  private:
+    std::vector<double> m_sizes;         //!< Flow sizes in bytes
+    std::vector<double> m_probabilities; //!< Cumulative probability of every size
+};
+
+/**
+* @brief Poisson short-flow traffic over pooled persistent connections.
+*/
+class WorkloadGenerator
+{
+  public:
+    /**
+    * @brief Generator settings.
+    */
+    struct Options
+    {
+        double load{0.5};           //!< Offered load, as a fraction of the bottleneck rate
+        double bottleneckBps{10e6}; //!< Bottleneck rate in bit/s
+        uint32_t poolSize{8};       //!< Largest number of connections per sender
+        uint16_t port{50002};       //!< Destination port of the workload connections
+        Time start{Seconds(0.1)};   //!< First possible arrival
+        Time stop{Seconds(100)};    //!< No arrival from this time on
+    };
+
+    /**
+    * @brief One flow and its completion time.
+    */
+    struct FlowRecord
+    {
+        uint32_t sender; //!< Sender index
+        bool abe;        //!< Whether the connections of the sender use ABE
+        uint64_t size;   //!< Flow size in bytes
+        Time start;      //!< Arrival time
+        Time end;        //!< Arrival of the last byte at the receiver, zero if incomplete
+        bool failed;     //!< Whether its connection failed before it completed
+    };
+
+    /**
+    * @brief Constructor
+    * @param cdf The flow size distribution.
+    * @param options The generator settings.
+    */
+    WorkloadGenerator(const FlowSizeCdf& cdf, const Options& options)
+        : m_cdf(cdf),
+          m_options(options),
+          m_interArrival(CreateObject<ExponentialRandomVariable>()),
+          m_uniform(CreateObject<UniformRandomVariable>())
+    {
+    }
+
+    /**
+    * @brief Add a sender, before the simulation starts.
+    * @param node The sender node.
+    * @param address The address of the sender node.
+    * @param receiver The address of its receiver.
+    * @param abe Whether its connections back off by BetaEcn on ECN marks.
+    */
+    void AddSender(Ptr<Node> node, Ipv4Address address, Ipv4Address receiver, bool abe)
+    {
+        Sender sender;
+        sender.node = node;
+        sender.address = address;
+        sender.receiver = receiver;
+        sender.abe = abe;
+        m_senders.push_back(sender);
+    }
+
+    /**
+    * @brief Accept workload connections on a receiver node.
+    * @param node The receiver node.
+    */
+    void AddSink(Ptr<Node> node)
+    {
+        Ptr<Socket> listener = Socket::CreateSocket(node, TcpSocketFactory::GetTypeId());
+        listener->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_options.port));
+        listener->Listen();
+        listener->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                    MakeCallback(&WorkloadGenerator::Accept, this));
+        m_listeners.push_back(listener);
+    }
+
+    /**
+    * @brief Schedule the first arrival of every sender.
+    */
+    void Start()
+    {
+        NS_ABORT_MSG_IF(m_senders.empty(), "Workload without senders");
+        NS_ABORT_MSG_UNLESS(m_options.load > 0 && m_options.poolSize > 0,
+                            "Workload load and pool size must be positive");
+        double rate = m_options.load * m_options.bottleneckBps / (8 * m_cdf.GetMean());
+        m_interArrival->SetAttribute("Mean", DoubleValue(m_senders.size() / rate));
+        for (uint32_t s = 0; s < m_senders.size(); s++)
+        {
+            ScheduleArrival(s, m_options.start);
+        }
+    }
+
+    /**
+    * @brief Use fixed random streams.
+    * @param stream The first stream index.
+    * @return Number of streams used.
+    */
+    int64_t AssignStreams(int64_t stream)
+    {
+        m_interArrival->SetStream(stream);
+        m_uniform->SetStream(stream + 1);
+        return 2;
+    }
+
+    /**
+    * @return Every flow started so far.
+    */
+    const std::vector<FlowRecord>& GetFlows() const
+    {
+        return m_flows;
+    }
+
+    /**
+    * @return Bytes received by the sinks so far, over all connections.
+    */
+    uint64_t GetRxBytes() const
+    {
+        return m_rxBytes;
+    }
+
+    /**
+    * @return Connections opened so far.
+    uint32_t GetConnections() const
+    {
+        return m_connections.size();
+    }
+
+    /**
+    * @return Connections that failed so far.
+    */
+    uint32_t GetFailedConnections() const
+    {
+        return m_failedConnections;
+    }
+
+  private:
+    /**
+    * @brief A sender and its connection pool.
+    */
+    struct Sender
+    {
+        Ptr<Node> node;                    //!< Sender node
+        Ipv4Address address;               //!< Address of the sender node
+        Ipv4Address receiver;              //!< Address of the receiver
+        bool abe{true};                    //!< Whether its connections use ABE
+        std::vector<uint32_t> connections; //!< Its connections
+        std::deque<uint32_t> backlog;      //!< Flows waiting for a connection
+    };
+
+    /**
+    * @brief A persistent connection and the flow it carries.
+    */
+    struct Connection
+    {
+        uint32_t sender;       //!< Sender index
+        Ptr<Socket> socket;    //!< Sender socket
+        bool connected{false}; //!< Whether the handshake is complete
+        bool busy{false};      //!< Whether a flow is in progress
+        uint32_t flow{0};      //!< Flow in progress
+        uint64_t txTarget{0};  //!< Bytes to hand to the socket, all flows so far
+        uint64_t txQueued{0};  //!< Bytes handed to the socket
+        uint64_t rxBytes{0};   //!< Bytes received by the sink
+        bool failed{false};    //!< Whether the connection failed and left the pool
+    };
+
+    /**
+    * @brief Schedule the next arrival of a sender.
+    * @param s The sender index.
+    * @param after The earliest arrival time.
+    */
+    void ScheduleArrival(uint32_t s, Time after)
+    {
+        Time at = after + Seconds(m_interArrival->GetValue());
+        if (at < m_options.stop)
+        {
+            Simulator::ScheduleWithContext(m_senders[s].node->GetId(),
+                                           at - Simulator::Now(),
+                                           &WorkloadGenerator::Arrival,
+                                           this,
+                                           s);
+        }
+    }
+
+    /**
+    * @brief Start a new flow of a sender.
+    * @param s The sender index.
+    */
+    void Arrival(uint32_t s)
+    {
+        Sender& sender = m_senders[s];
+        uint64_t size = m_cdf.Sample(m_uniform->GetValue());
+        m_flows.push_back(FlowRecord{s, sender.abe, size, Simulator::Now(), Seconds(0), false});
+        sender.backlog.push_back(m_flows.size() - 1);
+        Dispatch(s);
+        ScheduleArrival(s, Simulator::Now());
+    }
+
+    /**
+    * @brief Give waiting flows of a sender to its idle connections, opening
+    *        new connections up to the pool size.
+    * @param s The sender index.
+    */
+    void Dispatch(uint32_t s)
+    {
+        Sender& sender = m_senders[s];
+        for (uint32_t c : sender.connections)
+        {
+            if (sender.backlog.empty())
+            {
+                return;
+            }
+            Connection& conn = m_connections[c];
+            if (conn.connected && !conn.busy)
+            {
+                conn.busy = true;
+                conn.flow = sender.backlog.front();
+                sender.backlog.pop_front();
+                conn.txTarget += m_flows[conn.flow].size;
+                Send(c);
+            }
+        }
+        uint32_t opening = 0;
+        for (uint32_t c : sender.connections)
+        {
+            opening += !m_connections[c].connected;
+        }
+        if (sender.backlog.size() > opening && sender.connections.size() < m_options.poolSize)
+        {
+            Open(s);
+        }
+    }
+
+    /**
+    * @brief Open one more connection of a sender.
+    * @param s The sender index.
+    */
+    void Open(uint32_t s)
+    {
+        Sender& sender = m_senders[s];
+        uint32_t c = m_connections.size();
+        Connection conn;
+        conn.sender = s;
+        conn.socket = Socket::CreateSocket(sender.node, TcpSocketFactory::GetTypeId());
+        Ptr<TcpSocketBase> tcpSocket = DynamicCast<TcpSocketBase>(conn.socket);
+        NS_ASSERT_MSG(tcpSocket, "Workload sockets must be TCP sockets");
+        tcpSocket->SetEnableAbe(sender.abe);
+        conn.socket->Bind();
+        Address local;
+        conn.socket->GetSockName(local);
+        uint16_t localPort = InetSocketAddress::ConvertFrom(local).GetPort();
+        m_connectionByAddress[Key(sender.address, localPort)] = c;
+        conn.socket->SetConnectCallback(MakeBoundCallback(&WorkloadGenerator::Connected, this, c),
+                                        MakeBoundCallback(&WorkloadGenerator::Failed, this, c));
+        conn.socket->SetSendCallback(MakeBoundCallback(&WorkloadGenerator::SendSpace, this, c));
+        conn.socket->SetCloseCallbacks(MakeNullCallback<void, Ptr<Socket>>(),
+                                       MakeBoundCallback(&WorkloadGenerator::Failed, this, c));
+        m_connections.push_back(conn);
+        sender.connections.push_back(c);
+        m_connections[c].socket->Connect(InetSocketAddress(sender.receiver, m_options.port));
+    }
+
+    /**
+    * @brief Hand as many bytes of the current flow to the socket as it takes.
+    * @param c The connection index.
+    */
+    void Send(uint32_t c)
+    {
+        Connection& conn = m_connections[c];
+        while (!conn.failed && conn.txQueued < conn.txTarget)
+        {
+            uint32_t chunk = std::min<uint64_t>({conn.txTarget - conn.txQueued,
+                                                 conn.socket->GetTxAvailable(),
+                                                 65536});
+            if (chunk == 0 || conn.socket->Send(Create<Packet>(chunk)) < 0)
+            {
+                return; // Resumed by the send callback
+            }
+            conn.txQueued += chunk;
+        }
+    }
+
+    /**
+    * @brief Connection succeeded callback.
+    * @param generator The generator.
+    * @param c The connection index.
+    * @param socket The sender socket.
+    */
+    static void Connected(WorkloadGenerator* generator, uint32_t c, Ptr<Socket> socket)
+    {
+        generator->m_connections[c].connected = true;
+        generator->Dispatch(generator->m_connections[c].sender);
+    }
+
+    /**
+    * @brief Connection failed and error close callback.
+    *
+    * The connection leaves the pool of its sender and its flow, if any, is
+    * marked failed. Waiting flows are dispatched again, which opens a new
+    * connection in the freed slot if needed.
+    *
+    * @param generator The generator.
+    * @param c The connection index.
+    * @param socket The sender socket.
+    */
+    static void Failed(WorkloadGenerator* generator, uint32_t c, Ptr<Socket> socket)
+    {
+        Connection& conn = generator->m_connections[c];
+        if (conn.failed)
+        {
+            return;
+        }
+        conn.failed = true;
+        generator->m_failedConnections++;
+        if (conn.busy)
+        {
+            generator->m_flows[conn.flow].failed = true;
+            conn.busy = false;
+        }
+        std::vector<uint32_t>& pool = generator->m_senders[conn.sender].connections;
+        pool.erase(std::find(pool.begin(), pool.end(), c));
+        Simulator::ScheduleNow(&WorkloadGenerator::Dispatch, generator, conn.sender);
+    }
+
+    /**
+    * @brief Send buffer space callback.
+    * @param generator The generator.
+    * @param c The connection index.
+    * @param socket The sender socket.
+    * @param available Free bytes in the send buffer.
+    */
+    static void SendSpace(WorkloadGenerator* generator,
+                          uint32_t c,
+                          Ptr<Socket> socket,
+                          uint32_t available)
+    {
+        generator->Send(c);
+    }
+
+    /**
+    * @brief Accept callback of the sink sockets.
+    * @param socket The accepted socket.
+    * @param from The address of the sender socket.
+    */
+    void Accept(Ptr<Socket> socket, const Address& from)
+    {
+        InetSocketAddress peer = InetSocketAddress::ConvertFrom(from);
+        auto it = m_connectionByAddress.find(Key(peer.GetIpv4(), peer.GetPort()));
+        NS_ABORT_MSG_IF(it == m_connectionByAddress.end(), "Unknown workload connection");
+        socket->SetRecvCallback(MakeBoundCallback(&WorkloadGenerator::Receive, this, it->second));
+    }
+
+    /**
+    * @brief Receive callback of the sink sockets.
+    * @param generator The generator.
+    * @param c The connection index.
+    * @param socket The sink socket.
+    */
+    static void Receive(WorkloadGenerator* generator, uint32_t c, Ptr<Socket> socket)
+    {
+        Connection& conn = generator->m_connections[c];
+        while (Ptr<Packet> packet = socket->Recv())
+        {
+            if (packet->GetSize() == 0)
+            {
+                break;
+            }
+            conn.rxBytes += packet->GetSize();
+            generator->m_rxBytes += packet->GetSize();
+        }
+        if (conn.busy && conn.rxBytes >= conn.txTarget)
+        {
+            // The flow is complete, the connection takes the next one at the sender
+            generator->m_flows[conn.flow].end = Simulator::Now();
+            conn.busy = false;
+            Simulator::ScheduleWithContext(generator->m_senders[conn.sender].node->GetId(),
+                                           Seconds(0),
+                                           &WorkloadGenerator::Dispatch,
+                                           generator,
+                                           conn.sender);
+        }
+    }
+
+    /**
+    * @brief Key of a connection in the address table.
+    * @param address The sender address.
+    * @param port The sender port.
+    * @return The key.
+    */
+    static uint64_t Key(Ipv4Address address, uint16_t port)
+    {
+        return (static_cast<uint64_t>(address.Get()) << 16) | port;
+    }
+
+    FlowSizeCdf m_cdf;                             //!< Flow size distribution
+    Options m_options;                             //!< Generator settings
+    Ptr<ExponentialRandomVariable> m_interArrival; //!< Time between arrivals of a sender
+    Ptr<UniformRandomVariable> m_uniform;          //!< Flow size quantiles
+    std::vector<Sender> m_senders;                 //!< Senders
+    std::vector<Connection> m_connections;         //!< Connections of all senders
+    std::vector<Ptr<Socket>> m_listeners;          //!< Listening sink sockets
+    std::vector<FlowRecord> m_flows;               //!< Flows started so far
+    uint32_t m_failedConnections{0};               //!< Connections that failed
+    uint64_t m_rxBytes{0};                         //!< Bytes received by the sinks
+    //! Connection by sender address and port
+    std::unordered_map<uint64_t, uint32_t> m_connectionByAddress;
+};
+
+/**
+* @brief FCT statistics of the flows of one size bucket and ABE setting.
+*/
+struct FctBucket
+{
+    uint64_t lower;     //!< Smallest flow size of the bucket, in bytes
+    uint64_t upper;     //!< Largest flow size of the bucket, 0 for no limit
+    bool abe;           //!< ABE setting of the flows
+    uint32_t flows;     //!< Flows started
+    uint32_t completed; //!< Flows completed
+    uint32_t failed;    //!< Flows whose connection failed
+    double meanMs;      //!< Mean FCT of the completed flows
+    double p50Ms;       //!< Median FCT
+    double p99Ms;       //!< 99th percentile FCT
+};
+
+/**
+* @brief Nearest-rank quantile of sorted values.
+* @param sorted The values, in increasing order.
+* @param q The quantile, in [0, 1].
+* @return The quantile, 0 if there are no values.
+*/
+inline double
+SortedQuantile(const std::vector<double>& sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+/**
+* @brief Group flows by size bucket and ABE setting.
+* @param flows The flows.
+* @param edges Upper size limits of every bucket but the last, increasing.
+* @param splitAbe Whether ABE and non-ABE flows are summarized apart.
+* @return One entry per bucket and ABE setting with flows, buckets in order, ABE
+*         last. Without splitAbe, the entries have abe false and cover all flows.
+*/
+inline std::vector<FctBucket>
+SummarizeFct(const std::vector<WorkloadGenerator::FlowRecord>& flows,
+             const std::vector<uint64_t>& edges,
+             bool splitAbe = true)
+{
+    size_t nBuckets = edges.size() + 1;
+    std::vector<std::vector<double>> fcts(2 * nBuckets);
+    std::vector<uint32_t> started(2 * nBuckets, 0);
+    std::vector<uint32_t> failed(2 * nBuckets, 0);
+    for (const auto& flow : flows)
+    {
+        size_t b = std::lower_bound(edges.begin(), edges.end(), flow.size) - edges.begin();
+        size_t g = 2 * b + (splitAbe && flow.abe);
+        started[g]++;
+        failed[g] += flow.failed;
+        if (flow.end.IsStrictlyPositive())
+        {
+            fcts[g].push_back((flow.end - flow.start).ToDouble(Time::MS));
+        }
+    }
+    std::vector<FctBucket> buckets;
+    for (size_t g = 0; g < fcts.size(); g++)
+    {
+        if (started[g] == 0)
+        {
+            continue;
+        }
+        size_t b = g / 2;
+        std::vector<double>& v = fcts[g];
+        std::sort(v.begin(), v.end());
+        double sum = 0;
+        for (double x : v)
+        {
+            sum += x;
+        }
+        buckets.push_back(FctBucket{b == 0 ? 0 : edges[b - 1] + 1,
+                                    b < edges.size() ? edges[b] : 0,
+                                    g % 2 == 1,
+                                    started[g],
+                                    static_cast<uint32_t>(v.size()),
+                                    failed[g],
+                                    v.empty() ? 0 : sum / v.size(),
+                                    SortedQuantile(v, 0.5),
+                                    SortedQuantile(v, 0.99)});
+    }
+    return buckets;
+}
+
+} // namespace ns3
+
+#endif /* ABE_WORKLOAD_H */
@@ -0,0 +1,494 @@
+/**
+ * NS-3 TCP ABE Microbenchmarks
+ *
+ * This program measures the cost of the congestion control hot paths that
+ * ABE touches, as opposed to tcp-abe-test.cc which only checks their results.
+ * Every benchmark drives the real ns-3 objects with a pre-generated stream of
+ * congestion windows and RTT samples, so that the timed loop contains nothing
+ * but the calls made by TcpSocketBase:
+ *
+ * - <Algo>/GetSsThresh/Ecn/Abe, /Ecn/NoAbe and /Loss: one GetSsThresh call per
+ *   operation (one congestion event), for each combination of ABE and cause.
+ * - <Algo>/AckStream/Abe and /NoAbe: one PktsAcked and IncreaseWindow call per
+ *   operation (one ACK) in congestion avoidance, inside a running simulator so
+ *   that CUBIC sees time advance by one RTT per round. Every few dozen rounds
+ *   an ECN congestion event calls GetSsThresh and restarts the CUBIC epoch,
+ *   which includes the cubic root computation in the measured cost.
+ *
+ * Each benchmark is repeated and the fastest repetition is reported as ns/op,
+ * together with the heap allocations per operation. Results can be written to
+ * a baseline file and compared against it later, which fails the run if a
+ * benchmark got slower than the tolerance or allocates more than before.
+ *
+ * Note: Copy this file into the scratch directory of NS-3 and build it with
+ *       the optimized profile (./ns3 configure --build-profile=optimized).
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/object-factory.h"
+#include "ns3/tcp-congestion-ops.h"
+#include "ns3/tcp-cubic.h"
+#include "ns3/tcp-linux-reno.h"
+#include "ns3/tcp-socket-state.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TcpAbeBench");
+
+/// Number of heap allocations made by the program so far
+static uint64_t g_allocations = 0;
+
+void*
+operator new(std::size_t size)
+{
+    g_allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/// Results are accumulated here so that the compiler cannot drop the calls
+static volatile uint64_t g_sink = 0;
+
+/**
+ * @brief Outcome of one benchmark repetition.
+ */
+struct BenchResult
+{
+    uint64_t operations{0};  //!< Number of timed operations
+    double nanoseconds{0};   //!< Time spent in the timed loop
+    uint64_t allocations{0}; //!< Heap allocations made in the timed loop
+
+    /**
+     * @return Nanoseconds per operation.
+     */
+    double NsPerOp() const
+    {
+        return operations ? nanoseconds / operations : 0;
+    }
+
+    /**
+     * @return Heap allocations per operation.
+     */
+    double AllocsPerOp() const
+    {
+        return operations ? static_cast<double>(allocations) / operations : 0;
+    }
+};
+
+/**
+ * @brief Input streams shared by all benchmarks, generated before timing.
+ */
+struct BenchStreams
+{
+    std::vector<uint32_t> cwnd;         //!< Congestion windows in bytes
+    std::vector<Time> rtt;              //!< RTT samples
+    std::vector<uint32_t> lossInterval; //!< Rounds between congestion events
+};
+
+/// Size of the pre-generated streams, must be a power of two
+static const uint32_t STREAM_SIZE = 4096;
+
+/// Segment size used by all benchmarks
+static const uint32_t SEGMENT_SIZE = 1448;
+
+/**
+ * @brief Generate the input streams.
+ * @param seed Seed of the generator, so that every run sees the same input.
+ * @param baseRtt Propagation RTT; samples add up to 50% queueing delay.
+ * @return The streams.
+ */
+static BenchStreams
+GenerateStreams(uint32_t seed, Time baseRtt)
+{
+    std::mt19937 rng(seed);
+    // Windows between 10 and 5000 segments, log-uniform like a mix of short
+    // and long-RTT flows
+    std::uniform_real_distribution<double> logCwnd(std::log(10.0), std::log(5000.0));
+    std::uniform_real_distribution<double> queueing(0.0, 0.5);
+    std::uniform_int_distribution<uint32_t> interval(20, 60);
+
+    BenchStreams streams;
+    for (uint32_t i = 0; i < STREAM_SIZE; i++)
+    {
+        streams.cwnd.push_back(static_cast<uint32_t>(std::exp(logCwnd(rng))) * SEGMENT_SIZE);
+        streams.rtt.push_back(baseRtt + baseRtt * queueing(rng));
+        streams.lossInterval.push_back(interval(rng));
+    }
+    return streams;
+}
+
+/**
+ * @brief Create a congestion control and a socket state for a benchmark.
+ * @param tid The congestion control TypeId.
+ * @param enableAbe Whether ABE is enabled.
+ * @param cc The created congestion control.
+ * @param tcb The created socket state.
+ */
+static void
+CreateFlow(TypeId tid, bool enableAbe, Ptr<TcpCongestionOps>& cc, Ptr<TcpSocketState>& tcb)
+{
+    ObjectFactory factory;
+    factory.SetTypeId(tid);
+    cc = factory.Create<TcpCongestionOps>();
+    tcb = CreateObject<TcpSocketState>();
+    tcb->m_segmentSize = SEGMENT_SIZE;
+    tcb->m_enableAbe = enableAbe;
+    tcb->m_cWnd = 100 * SEGMENT_SIZE;
+    tcb->m_ssThresh = 100 * SEGMENT_SIZE;
+}
+
+/**
+ * @brief Time GetSsThresh for one congestion event per operation.
+ * @param tid The congestion control TypeId.
+ * @param enableAbe Whether ABE is enabled.
+ * @param cause The reduction cause recorded by the socket.
+ * @param streams The input streams.
+ * @param operations Number of congestion events.
+ * @return The result.
+ */
+static BenchResult
+BenchGetSsThresh(TypeId tid,
+                 bool enableAbe,
+                 TcpSocketState::ReductionCause_t cause,
+                 const BenchStreams& streams,
+                 uint64_t operations)
+{
+    Ptr<TcpCongestionOps> cc;
+    Ptr<TcpSocketState> tcb;
+    CreateFlow(tid, enableAbe, cc, tcb);
+    tcb->m_reductionCause = cause;
+    tcb->m_ecnState = (cause == TcpSocketState::REDUCTION_ECN) ? TcpSocketState::ECN_ECE_RCVD
+                                                               : TcpSocketState::ECN_IDLE;
+
+    uint64_t sink = 0;
+    uint64_t allocations = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < operations; i++)
+    {
+        tcb->m_cWnd = streams.cwnd[i & (STREAM_SIZE - 1)];
+        sink += cc->GetSsThresh(tcb, tcb->m_cWnd);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    BenchResult result;
+    result.operations = operations;
+    result.nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+    result.allocations = g_allocations - allocations;
+    g_sink = g_sink + sink;
+    return result;
+}
+
+/**
+ * @brief ACK stream in congestion avoidance, one round per RTT.
+ *
+ * Each round is a simulator event, so that Simulator::Now() advances as it
+ * does for a real flow. Only the calls into the congestion control are timed,
+ * not the scheduler.
+ */
+class AckStreamBench
+{
+  public:
+    /**
+     * @brief Constructor
+     * @param tid The congestion control TypeId.
+     * @param enableAbe Whether ABE is enabled.
+     * @param streams The input streams.
+     * @param operations Number of ACKs to process.
+     */
+    AckStreamBench(TypeId tid, bool enableAbe, const BenchStreams& streams, uint64_t operations)
+        : m_streams(streams),
+          m_remaining(operations)
+    {
+        CreateFlow(tid, enableAbe, m_cc, m_tcb);
+        m_result.operations = operations;
+        m_roundsToLoss = m_streams.lossInterval[0];
+    }
+
+    /**
+     * @brief Run the ACK stream to completion.
+     * @return The result.
+     */
+    BenchResult Run()
+    {
+        Simulator::ScheduleNow(&AckStreamBench::Round, this);
+        Simulator::Run();
+        Simulator::Destroy();
+        return m_result;
+    }
+
+  private:
+    /**
+     * @brief Acknowledge one window of segments, then schedule the next round.
+     */
+    void Round()
+    {
+        Time rtt = m_streams.rtt[m_round & (STREAM_SIZE - 1)];
+        uint64_t acks = std::min<uint64_t>(m_tcb->m_cWnd / SEGMENT_SIZE, m_remaining);
+        bool congestion = --m_roundsToLoss == 0;
+
+        uint64_t allocations = g_allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < acks; i++)
+        {
+            m_cc->PktsAcked(m_tcb, 1, rtt);
+            m_cc->IncreaseWindow(m_tcb, 1);
+        }
+        if (congestion)
+        {
+            m_tcb->m_reductionCause = TcpSocketState::REDUCTION_ECN;
+            m_tcb->m_ecnState = TcpSocketState::ECN_ECE_RCVD;
+            uint32_t ssThresh = m_cc->GetSsThresh(m_tcb, m_tcb->m_cWnd);
+            m_tcb->m_ssThresh = ssThresh;
+            m_tcb->m_cWnd = ssThresh;
+            m_tcb->m_reductionCause = TcpSocketState::REDUCTION_NONE;
+            m_tcb->m_ecnState = TcpSocketState::ECN_IDLE;
+        }
+        auto end = std::chrono::steady_clock::now();
+        m_result.nanoseconds += std::chrono::duration<double, std::nano>(end - start).count();
+        m_result.allocations += g_allocations - allocations;
+
+        if (congestion)
+        {
+            m_roundsToLoss = m_streams.lossInterval[m_round & (STREAM_SIZE - 1)];
+        }
+        m_remaining -= acks;
+        m_round++;
+        if (m_remaining > 0)
+        {
+            Simulator::Schedule(rtt, &AckStreamBench::Round, this);
+        }
+        g_sink = g_sink + m_tcb->m_cWnd.Get();
+    }
+
+    const BenchStreams& m_streams; //!< Input streams
+    Ptr<TcpCongestionOps> m_cc;    //!< Congestion control under test
+    Ptr<TcpSocketState> m_tcb;     //!< Socket state of the flow
+    uint64_t m_remaining;          //!< ACKs left to process
+    uint64_t m_round{0};           //!< Rounds completed
+    uint32_t m_roundsToLoss{0};    //!< Rounds until the next congestion event
+    BenchResult m_result;          //!< Accumulated result
+};
+
+/**
+ * @brief Baseline entry of one benchmark.
+ */
+struct BaselineEntry
+{
+    double nsPerOp;     //!< Nanoseconds per operation
+    double allocsPerOp; //!< Heap allocations per operation
+};
+
+/**
+ * @brief Read a baseline file, "name nsPerOp allocsPerOp" per line.
+ * @param path The file path.
+ * @return The entries by benchmark name, empty if the file cannot be read.
+ */
+static std::map<std::string, BaselineEntry>
+ReadBaseline(const std::string& path)
+{
+    std::map<std::string, BaselineEntry> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string name;
+        BaselineEntry entry;
+        if (fields >> name >> entry.nsPerOp >> entry.allocsPerOp)
+        {
+            baseline[name] = entry;
+        }
+    }
+    return baseline;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint64_t iterations = 10000000;
+    uint32_t repetitions = 3;
+    uint32_t seed = 1;
+    Time baseRtt = MilliSeconds(50);
+    std::string filter = "";
+    std::string baselineFile = "";
+    std::string writeBaselineFile = "";
+    double tolerance = 0.10;
+
+    // Command-line argument parsing
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("iterations", "Operations per benchmark repetition", iterations);
+    cmd.AddValue("repetitions", "Repetitions per benchmark, the fastest is reported", repetitions);
+    cmd.AddValue("seed", "Seed of the cwnd and RTT streams", seed);
+    cmd.AddValue("baseRtt", "Propagation RTT of the ACK streams", baseRtt);
+    cmd.AddValue("filter", "Only run benchmarks whose name contains this string", filter);
+    cmd.AddValue("baseline", "Compare against this baseline file", baselineFile);
+    cmd.AddValue("writeBaseline", "Write the results to this baseline file", writeBaselineFile);
+    cmd.AddValue("tolerance", "Allowed relative slowdown against the baseline", tolerance);
+    cmd.Parse(argc, argv);
+
+    BenchStreams streams = GenerateStreams(seed, baseRtt);
+
+    // Benchmarks in output order
+    std::vector<std::pair<std::string, std::function<BenchResult()>>> benchmarks;
+    std::vector<std::pair<std::string, TypeId>> algorithms = {
+        {"TcpCubic", TcpCubic::GetTypeId()},
+        {"TcpLinuxReno", TcpLinuxReno::GetTypeId()},
+    };
+    for (const auto& algorithm : algorithms)
+    {
+        TypeId tid = algorithm.second;
+        for (bool abe : {true, false})
+        {
+            std::string name = algorithm.first + "/GetSsThresh/Ecn/" + (abe ? "Abe" : "NoAbe");
+            benchmarks.emplace_back(name, [&, tid, abe]() {
+                return BenchGetSsThresh(tid,
+                                        abe,
+                                        TcpSocketState::REDUCTION_ECN,
+                                        streams,
+                                        iterations);
+            });
+        }
+        benchmarks.emplace_back(algorithm.first + "/GetSsThresh/Loss", [&, tid]() {
+            return BenchGetSsThresh(tid,
+                                    true,
+                                    TcpSocketState::REDUCTION_FAST_RETRANSMIT,
+                                    streams,
+                                    iterations);
+        });
+        for (bool abe : {true, false})
+        {
+            std::string name = algorithm.first + "/AckStream/" + (abe ? "Abe" : "NoAbe");
+            benchmarks.emplace_back(name, [&, tid, abe]() {
+                AckStreamBench bench(tid, abe, streams, iterations);
+                return bench.Run();
+            });
+        }
+    }
+
+    std::map<std::string, BaselineEntry> baseline;
+    if (!baselineFile.empty())
+    {
+        baseline = ReadBaseline(baselineFile);
+        if (baseline.empty())
+        {
+            std::cerr << "Cannot read baseline " << baselineFile << std::endl;
+            return 1;
+        }
+    }
+
+    std::ofstream baselineOut;
+    if (!writeBaselineFile.empty())
+    {
+        baselineOut.open(writeBaselineFile);
+        if (!baselineOut.is_open())
+        {
+            std::cerr << "Cannot open " << writeBaselineFile << std::endl;
+            return 1;
+        }
+        baselineOut << "# name nsPerOp allocsPerOp, iterations=" << iterations
+                    << " repetitions=" << repetitions << " seed=" << seed << std::endl;
+    }
+
+    std::cout << std::left << std::setw(36) << "Benchmark" << std::right << std::setw(12)
+              << "ns/op" << std::setw(14) << "allocs/op" << std::setw(12) << "baseline"
+              << "  status" << std::endl;
+
+    uint32_t regressions = 0;
+    for (const auto& [name, run] : benchmarks)
+    {
+        if (name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        BenchResult best;
+        for (uint32_t r = 0; r < std::max(repetitions, 1U); r++)
+        {
+            BenchResult result = run();
+            if (r == 0 || result.NsPerOp() < best.NsPerOp())
+            {
+                best = result;
+            }
+        }
+
+        std::string status = "";
+        std::ostringstream base;
+        auto it = baseline.find(name);
+        if (!baselineFile.empty() && it == baseline.end())
+        {
+            base << "-";
+            status = "new";
+        }
+        else if (it != baseline.end())
+        {
+            base << std::fixed << std::setprecision(2) << it->second.nsPerOp;
+            if (best.NsPerOp() > it->second.nsPerOp * (1 + tolerance))
+            {
+                status = "SLOWER";
+                regressions++;
+            }
+            else if (best.AllocsPerOp() > it->second.allocsPerOp + 1e-6)
+            {
+                status = "ALLOCS";
+                regressions++;
+            }
+            else
+            {
+                status = "ok";
+            }
+        }
+
+        std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(12) << best.NsPerOp()
+                  << std::setprecision(4) << std::setw(14) << best.AllocsPerOp() << std::setw(12)
+                  << base.str() << "  " << status << std::endl;
+
+        if (baselineOut.is_open())
+        {
+            baselineOut << name << " " << std::setprecision(2) << best.NsPerOp() << " "
+                        << std::setprecision(4) << best.AllocsPerOp() << std::endl;
+        }
+    }
+
+    if (regressions > 0)
+    {
+        std::cerr << regressions << " benchmark(s) regressed against " << baselineFile
+                  << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,409 @@
+/**
+ * NS-3 TCP ABE Property Test Suite
+ *
+ * The cases of tcp-abe-test.cc use a few hand-picked inputs (1000 segments of
+ * 1 byte). This file checks GetSsThresh of CUBIC, Linux Reno and NewReno
+ * against a reference model of RFC 8511 on millions of generated
+ * TcpSocketState inputs:
+ *
+ * - segment sizes of 1 byte to jumbo frames, congestion windows of 0 to 2^20
+ *   segments (log-uniform, so the floor of 2 segments is hit as often as
+ *   large windows) with a partial last segment;
+ * - every ECN state and reduction cause, with and without ABE;
+ * - several Beta / BetaEcn pairs, including the defaults.
+ *
+ * The reference model computes the window in exact integer arithmetic, with
+ * the decrease factors as percentages:
+ *
+ *   CUBIC:      max(floor(segCwnd * beta), 2) * segmentSize
+ *   Linux Reno: max(floor(cWnd * beta), 2 * segmentSize)
+ *   NewReno:    max(floor(bytesInFlight * beta), 2 * segmentSize)
+ *
+ * where beta is BetaEcn if ABE is enabled and the reduction is caused by ECN
+ * (or, without a recorded cause, ECE was received), and Beta otherwise.
+ * NewReno has no Beta attribute: its loss decrease stays at the default of 0.5
+ * and only BetaEcn varies.
+ *
+ * Input i is a pure function of the RNG seed, the run number and i, so the
+ * cases are split across all cores and any failure is reproduced with the
+ * same --RngSeed/--RngRun. A failing input is shrunk (smaller window and
+ * segment size, ABE and ECN fields reset) while it still fails, and both the
+ * shrunk and the original input are reported.
+ *
+ * - TcpAbeSsThreshPropertyTest: Compares GetSsThresh with the reference model.
+ * - TcpAbePropertyTestSuite: Registers 200000 cases per algorithm as a quick
+ *   test and 10 million as an extensive test.
+ *
+ * Note: Make sure to add this test file in CMakeLists.txt to integrate it into
+ * the NS-3 testing framework.
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/tcp-socket-state.h"
+#include "ns3/tcp-congestion-ops.h"
+#include "ns3/tcp-cubic.h"
+#include "ns3/tcp-linux-reno.h"
+#include "ns3/object-factory.h"
+#include "ns3/double.h"
+#include "ns3/rng-seed-manager.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3
+{
+NS_LOG_COMPONENT_DEFINE("TcpAbePropertyTestSuite");
+
+/**
+ * Beta and BetaEcn pairs, in percent, the first one being replaced by the
+ * defaults of the algorithm
+ */
+static const uint32_t g_betaPercent[][2] = {{0, 0}, {50, 70}, {50, 80}, {70, 85}, {75, 95}, {80, 90}, {60, 65}};
+
+/// Number of Beta and BetaEcn pairs
+static const uint32_t g_betaPairs = sizeof(g_betaPercent) / sizeof(g_betaPercent[0]);
+
+/**
+ * Input of one GetSsThresh call
+ */
+struct AbeSsThreshInput
+{
+    uint32_t segmentSize;                      //!< Segment size in bytes
+    uint32_t cWnd;                             //!< Congestion window in bytes
+    TcpSocketState::EcnState_t ecnState;       //!< ECN state
+    TcpSocketState::ReductionCause_t cause;    //!< Recorded reduction cause
+    bool enableAbe;                            //!< ABE enabled on the socket
+    uint32_t betaPair;                         //!< Index in g_betaPercent
+};
+
+/**
+ * @brief Describe an input for a failure message
+ * @param in The input.
+ * @return The fields of the input.
+ */
+static std::string
+AbeSsThreshInputToString(const AbeSsThreshInput& in)
+{
+    std::ostringstream os;
+    os << "segmentSize=" << in.segmentSize << " cWnd=" << in.cWnd
+       << " ecnState=" << TcpSocketState::EcnStateName[in.ecnState]
+       << " cause=" << TcpSocketState::ReductionCauseName[in.cause]
+       << " enableAbe=" << in.enableAbe << " betaPair=" << in.betaPair;
+    return os.str();
+}
+
+/**
+ * @brief SplitMix64 hash, a counter-based generator of independent draws.
+ * @param x The counter.
+ * @return 64 random bits.
+ */
+static uint64_t
+SplitMix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Test case comparing GetSsThresh with a reference model of RFC 8511
+ */
+class TcpAbeSsThreshPropertyTest : public TestCase
+{
+    private:
+        TypeId m_congControl;//!<Congestion control under test
+        bool m_segmentGranular;//!<The algorithm reduces a whole number of segments (CUBIC)
+        uint64_t m_cases;//!<Number of generated inputs
+        uint32_t m_defaultBeta;//!<Default Beta of the algorithm, in percent
+        uint32_t m_defaultBetaEcn;//!<Default BetaEcn of the algorithm, in percent
+        bool m_fixedBeta;//!<The algorithm has no Beta attribute (NewReno)
+
+    public:
+        /**
+        * @brief Constructor
+        *
+        * @param congControl TypeId of the congestion control algorithm
+        * @param segmentGranular true if the window is reduced in whole segments
+        * @param defaultBeta default Beta of the algorithm, in percent
+        * @param defaultBetaEcn default BetaEcn of the algorithm, in percent
+        * @param cases number of generated inputs
+        * @param desc Description of the test
+        */
+        TcpAbeSsThreshPropertyTest(
+            TypeId congControl,
+            bool segmentGranular,
+            uint32_t defaultBeta,
+            uint32_t defaultBetaEcn,
+            uint64_t cases,
+            const std::string& desc) :
+                TestCase(desc),
+                m_congControl(congControl),
+                m_segmentGranular(segmentGranular),
+                m_cases(cases),
+                m_defaultBeta(defaultBeta),
+                m_defaultBetaEcn(defaultBetaEcn)
+            {
+                TypeId::AttributeInformation info;
+                m_fixedBeta = !m_congControl.LookupAttributeByName("Beta", &info);
+            }
+
+    private:
+        /**
+        * @brief Generate input i.
+        * @param seed Seed of the run.
+        * @param i Index of the input.
+        * @return The input.
+        */
+        static AbeSsThreshInput Generate(uint64_t seed, uint64_t i)
+        {
+            uint64_t r0 = SplitMix64(seed ^ SplitMix64(2 * i));
+            uint64_t r1 = SplitMix64(seed ^ SplitMix64(2 * i + 1));
+            static const uint32_t sizes[] = {1, 536, 1448, 1460, 8948};
+
+            AbeSsThreshInput in;
+            uint32_t sizeDraw = r0 % 6;
+            r0 /= 6;
+            in.segmentSize = sizeDraw < 5 ? sizes[sizeDraw] : 1 + r0 % 9000;
+            r0 /= 9000;
+
+            //Log-uniform number of segments up to 2^20, within 32 bits of bytes
+            uint32_t bits = r0 % 21;
+            r0 /= 21;
+            uint64_t segments = (r1 & 0xfffff) & ((1ULL << bits) - 1);
+            uint64_t maxSegments = (std::numeric_limits<uint32_t>::max() / in.segmentSize) - 1;
+            segments = std::min(segments, maxSegments);
+            in.cWnd = static_cast<uint32_t>(segments * in.segmentSize + (r1 >> 20) % in.segmentSize);
+
+            in.ecnState = static_cast<TcpSocketState::EcnState_t>(r0 % (TcpSocketState::ECN_CWR_SENT + 1));
+            r0 /= TcpSocketState::ECN_CWR_SENT + 1;
+            in.cause = static_cast<TcpSocketState::ReductionCause_t>(r0 % TcpSocketState::REDUCTION_LAST_CAUSE);
+            r0 /= TcpSocketState::REDUCTION_LAST_CAUSE;
+            in.enableAbe = r0 % 2;
+            r0 /= 2;
+            in.betaPair = r0 % g_betaPairs;
+            return in;
+        }
+
+        /**
+        * @brief Get the decrease factors of a pair.
+        * @param pair Index in g_betaPercent.
+        * @param ecn true for BetaEcn, false for Beta.
+        * @return The factor, in percent.
+        */
+        uint32_t GetBetaPercent(uint32_t pair, bool ecn) const
+        {
+            if (pair == 0 || (m_fixedBeta && !ecn))
+            {
+                return ecn ? m_defaultBetaEcn : m_defaultBeta;
+            }
+            return g_betaPercent[pair][ecn ? 1 : 0];
+        }
+
+        /**
+        * @brief RFC 8511 reference model of the slow start threshold.
+        * @param in The input.
+        * @return The expected slow start threshold in bytes.
+        */
+        uint32_t Reference(const AbeSsThreshInput& in) const
+        {
+            bool ecnReduction = in.enableAbe &&
+                                (in.cause == TcpSocketState::REDUCTION_NONE
+                                     ? in.ecnState == TcpSocketState::ECN_ECE_RCVD
+                                     : in.cause == TcpSocketState::REDUCTION_ECN);
+            uint64_t percent = GetBetaPercent(in.betaPair, ecnReduction);
+            if (m_segmentGranular)
+            {
+                uint64_t segments = in.cWnd / in.segmentSize;
+                return static_cast<uint32_t>(std::max<uint64_t>(segments * percent / 100, 2) * in.segmentSize);
+            }
+            return static_cast<uint32_t>(std::max<uint64_t>(uint64_t(in.cWnd) * percent / 100, 2 * in.segmentSize));
+        }
+
+        /**
+        * @brief Objects driven by one worker thread.
+        */
+        struct Worker
+        {
+            Ptr<TcpSocketState> state;//!<Socket state, overwritten by every input
+            std::vector<Ptr<TcpCongestionOps>> congControls;//!<One algorithm per Beta pair
+            uint64_t firstFailure;//!<Index of the first failing input of the worker
+        };
+
+        /**
+        * @brief Create the objects of a worker, on the main thread.
+        * @return The worker.
+        */
+        Worker CreateWorker() const
+        {
+            Worker worker;
+            worker.state = CreateObject<TcpSocketState>();
+            ObjectFactory factory;
+            factory.SetTypeId(m_congControl);
+            for (uint32_t pair = 0; pair < g_betaPairs; pair++)
+            {
+                Ptr<TcpCongestionOps> congControl = factory.Create<TcpCongestionOps>();
+                if (!m_fixedBeta)
+                {
+                    congControl->SetAttribute("Beta", DoubleValue(GetBetaPercent(pair, false) / 100.0));
+                }
+                congControl->SetAttribute("BetaEcn", DoubleValue(GetBetaPercent(pair, true) / 100.0));
+                worker.congControls.push_back(congControl);
+            }
+            worker.firstFailure = std::numeric_limits<uint64_t>::max();
+            return worker;
+        }
+
+        /**
+        * @brief Call GetSsThresh on an input.
+        * @param worker Objects to use.
+        * @param in The input.
+        * @return The slow start threshold in bytes.
+        */
+        static uint32_t Run(Worker& worker, const AbeSsThreshInput& in)
+        {
+            Ptr<TcpSocketState> state = worker.state;
+            state->m_segmentSize = in.segmentSize;
+            state->m_cWnd = in.cWnd;
+            state->m_ecnState = in.ecnState;
+            state->m_reductionCause = in.cause;
+            state->m_enableAbe = in.enableAbe;
+            return worker.congControls[in.betaPair]->GetSsThresh(state, in.cWnd);
+        }
+
+        /**
+        * @brief Shrink a failing input while it still fails.
+        * @param worker Objects to use.
+        * @param in The failing input.
+        * @return A failing input none of whose simplifications fail.
+        */
+        AbeSsThreshInput Shrink(Worker& worker, AbeSsThreshInput in) const
+        {
+            bool shrunk = true;
+            while (shrunk)
+            {
+                shrunk = false;
+                std::vector<AbeSsThreshInput> candidates;
+                auto add = [&candidates, &in](auto change) {
+                    AbeSsThreshInput c = in;
+                    change(c);
+                    candidates.push_back(c);
+                };
+                add([](AbeSsThreshInput& c) { c.cWnd /= 2; });
+                add([](AbeSsThreshInput& c) { c.cWnd -= std::min(c.cWnd, c.segmentSize); });
+                add([](AbeSsThreshInput& c) { c.cWnd -= std::min(c.cWnd, 1U); });
+                add([](AbeSsThreshInput& c) { c.cWnd = c.cWnd / c.segmentSize; c.segmentSize = 1; });
+                add([](AbeSsThreshInput& c) { c.segmentSize = std::max(c.segmentSize / 2, 1U); });
+                add([](AbeSsThreshInput& c) { c.enableAbe = false; });
+                add([](AbeSsThreshInput& c) { c.cause = TcpSocketState::REDUCTION_NONE; });
+                add([](AbeSsThreshInput& c) { c.ecnState = TcpSocketState::ECN_DISABLED; });
+                add([](AbeSsThreshInput& c) { c.betaPair = 0; });
+                for (const AbeSsThreshInput& c : candidates)
+                {
+                    bool simpler = c.cWnd < in.cWnd || c.segmentSize < in.segmentSize ||
+                                   c.enableAbe != in.enableAbe || c.cause != in.cause ||
+                                   c.ecnState != in.ecnState || c.betaPair != in.betaPair;
+                    if (simpler && Run(worker, c) != Reference(c))
+                    {
+                        in = c;
+                        shrunk = true;
+                        break;
+                    }
+                }
+            }
+            return in;
+        }
+
+        void DoRun() override
+        {
+            uint64_t seed = SplitMix64(RngSeedManager::GetSeed()) ^ RngSeedManager::GetRun();
+            uint32_t nWorkers = std::max(std::thread::hardware_concurrency(), 1U);
+
+            //Objects are created here, the workers only call GetSsThresh on their own objects
+            std::vector<Worker> workers;
+            for (uint32_t w = 0; w < nWorkers; w++)
+            {
+                workers.push_back(CreateWorker());
+            }
+
+            std::vector<std::thread> threads;
+            for (uint32_t w = 0; w < nWorkers; w++)
+            {
+                threads.emplace_back([this, &workers, seed, nWorkers, w]() {
+                    uint64_t begin = m_cases * w / nWorkers;
+                    uint64_t end = m_cases * (w + 1) / nWorkers;
+                    for (uint64_t i = begin; i < end; i++)
+                    {
+                        AbeSsThreshInput in = Generate(seed, i);
+                        if (Run(workers[w], in) != Reference(in))
+                        {
+                            workers[w].firstFailure = i;
+                            return;
+                        }
+                    }
+                });
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            uint64_t firstFailure = std::numeric_limits<uint64_t>::max();
+            for (const Worker& worker : workers)
+            {
+                firstFailure = std::min(firstFailure, worker.firstFailure);
+            }
+            if (firstFailure == std::numeric_limits<uint64_t>::max())
+            {
+                return;
+            }
+
+            AbeSsThreshInput original = Generate(seed, firstFailure);
+            AbeSsThreshInput in = Shrink(workers[0], original);
+            NS_TEST_EXPECT_MSG_EQ(Run(workers[0], in),
+                Reference(in),
+                m_congControl.GetName() << "::GetSsThresh differs from RFC 8511 for "
+                    << AbeSsThreshInputToString(in) << " (input " << firstFailure
+                    << ", shrunk from " << AbeSsThreshInputToString(original) << ")");
+        }
+};
+
+/**
+ * Test suite for the ABE property tests
+ */
+class TcpAbePropertyTestSuite : public TestSuite
+{
+    public:
+        TcpAbePropertyTestSuite() : TestSuite("tcp-abe-property-test", Type::UNIT)
+        {
+            AddTestCase(new TcpAbeSsThreshPropertyTest(TcpCubic::GetTypeId(), true, 70, 85, 200000,
+                                                       "Test CUBIC against RFC 8511 on 200000 inputs"),
+                        TestCase::Duration::QUICK);
+            AddTestCase(new TcpAbeSsThreshPropertyTest(TcpLinuxReno::GetTypeId(), false, 50, 70, 200000,
+                                                       "Test Linux Reno against RFC 8511 on 200000 inputs"),
+                        TestCase::Duration::QUICK);
+            AddTestCase(new TcpAbeSsThreshPropertyTest(TcpNewReno::GetTypeId(), false, 50, 70, 200000,
+                                                       "Test NewReno against RFC 8511 on 200000 inputs"),
+                        TestCase::Duration::QUICK);
+            AddTestCase(new TcpAbeSsThreshPropertyTest(TcpCubic::GetTypeId(), true, 70, 85, 10000000,
+                                                       "Test CUBIC against RFC 8511 on 10 million inputs"),
+                        TestCase::Duration::EXTENSIVE);
+            AddTestCase(new TcpAbeSsThreshPropertyTest(TcpLinuxReno::GetTypeId(), false, 50, 70, 10000000,
+                                                       "Test Linux Reno against RFC 8511 on 10 million inputs"),
+                        TestCase::Duration::EXTENSIVE);
+            AddTestCase(new TcpAbeSsThreshPropertyTest(TcpNewReno::GetTypeId(), false, 50, 70, 10000000,
+                                                       "Test NewReno against RFC 8511 on 10 million inputs"),
+                        TestCase::Duration::EXTENSIVE);
+        }
+};
+
+// Register test suite
+static TcpAbePropertyTestSuite g_tcpAbePropertyTestSuite;
+
+}
@@ -8,6 +8,14 @@
  * - TcpAbeToggleTest: Verifies enabling and disabling ABE.
  * - TcpCubicAbeTest: Tests CUBIC congestion control behavior with ABE.
  * - TcpLinuxRenoAbeTest: Tests Linux Reno congestion control behavior with ABE.
+ * - TcpAbeBackoffTest: Tests the shared ABE backoff policy in NewReno, BIC,
+ *   HighSpeed and Scalable.
+ * - TcpAbeReductionCauseTest: Checks that the recorded reduction cause, not
+ *   the ECN state, selects Beta or BetaEcn.
+ * - TcpAbeAdaptiveTest: Checks that adaptive ABE picks BetaEcn from the
+ *   marking rate.
+ * - TcpAbeAccEcnTest: Checks the AccECN option encoding and that the CE byte
+ *   counts drive the marking rate.
  * - TcpAbeTestSuite: Registers and runs all ABE-related test cases.
  *
  * This test suite ensures the correct implementation of ABE in NS-3 by 
@@ -22,6 +30,14 @@
 #include "ns3/tcp-socket-state.h"
 #include "ns3/tcp-cubic.h"
 #include "ns3/tcp-linux-reno.h"
+#include "ns3/tcp-congestion-ops.h"
+#include "ns3/tcp-bic.h"
+#include "ns3/tcp-highspeed.h"
+#include "ns3/tcp-scalable.h"
+#include "ns3/object-factory.h"
+#include "ns3/tcp-abe-backoff.h"
+#include "ns3/tcp-option-accecn.h"
+#include "ns3/buffer.h"
 
 
 namespace ns3
@@ -217,6 +233,266 @@ class TcpLinuxRenoAbeTest : public TestCase
         }
 };
 
+/**
+ * Test case for the congestion controls using the shared ABE backoff policy
+ */
+class TcpAbeBackoffTest : public TestCase
+{
+    private:
+        TypeId m_congControl;//!<Congestion control to test
+        bool m_enableAbe;//!<Whether ABE is enabled
+        uint32_t m_initialCwnd;//!<Initial congestion window
+        uint32_t m_expectedCwnd;//!<Expected congestion window after applying Beta/BetaEcn
+        uint32_t m_bytesInFlight;//!<Bytes in flight
+
+    public:
+        /**
+        * @brief Constructor
+        *
+        * @param congControl TypeId of the congestion control
+        * @param enableAbe whether ABE is enabled
+        * @param initialCwnd initial congestion window, with a segment size of 1
+        * @param expectedCwnd expected slow start threshold
+        * @param bytesInFlight bytes in flight
+        * @param desc Description about the congestion window reduction
+        */
+        TcpAbeBackoffTest(
+            TypeId congControl,
+            bool enableAbe,
+            uint32_t initialCwnd,
+            uint32_t expectedCwnd,
+            uint32_t bytesInFlight,
+            const std::string& desc) :
+                TestCase(desc),
+                m_congControl(congControl),
+                m_enableAbe(enableAbe),
+                m_initialCwnd(initialCwnd),
+                m_expectedCwnd(expectedCwnd),
+                m_bytesInFlight(bytesInFlight)
+            {}
+
+        void DoRun() override
+        {
+            ObjectFactory factory;
+            factory.SetTypeId(m_congControl);
+            Ptr<TcpCongestionOps> congControl = factory.Create<TcpCongestionOps>();
+            Ptr<TcpSocketState> state = CreateObject<TcpSocketState>();
+
+            //Configure TCP state
+            state->m_enableAbe=m_enableAbe;
+            state->m_ecnState=TcpSocketState::ECN_ECE_RCVD;
+            state->m_segmentSize=1;
+            state->m_cWnd=m_initialCwnd;
+            state->m_bytesInFlight=m_bytesInFlight;
+            //update cwnd
+            state->m_cWnd=congControl->GetSsThresh(state, m_bytesInFlight);
+
+            NS_TEST_EXPECT_MSG_EQ(state->m_cWnd,
+                m_expectedCwnd,
+                congControl->GetName() << (m_enableAbe ? " should apply BetaEcn correctly"
+                                                       : " should apply Beta correctly"));
+        }
+};
+
+/**
+ * Test case for the reduction cause recorded by the socket
+ */
+class TcpAbeReductionCauseTest : public TestCase
+{
+    private:
+        TcpSocketState::ReductionCause_t m_cause;//!<Cause recorded before GetSsThresh
+        TcpSocketState::EcnState_t m_ecnState;//!<ECN state at the time of the reduction
+        uint32_t m_expectedCwnd;//!<Expected congestion window after applying Beta/BetaEcn
+
+    public:
+        /**
+        * @brief Constructor
+        *
+        * @param cause reduction cause recorded by the socket
+        * @param ecnState ECN state at the time of the reduction
+        * @param expectedCwnd expected slow start threshold of CUBIC with 1000 segments
+        * @param desc Description about the congestion window reduction
+        */
+        TcpAbeReductionCauseTest(
+            TcpSocketState::ReductionCause_t cause,
+            TcpSocketState::EcnState_t ecnState,
+            uint32_t expectedCwnd,
+            const std::string& desc) :
+                TestCase(desc),
+                m_cause(cause),
+                m_ecnState(ecnState),
+                m_expectedCwnd(expectedCwnd)
+            {}
+
+        void DoRun() override
+        {
+            Ptr<TcpCubic> cubic = CreateObject<TcpCubic>();
+            Ptr<TcpSocketState> state = CreateObject<TcpSocketState>();
+
+            //Configure TCP state
+            state->m_enableAbe=true;
+            state->m_ecnState=m_ecnState;
+            state->m_reductionCause=m_cause;
+            state->m_segmentSize=1;
+            state->m_cWnd=1000;
+            //update cwnd
+            state->m_cWnd=cubic->GetSsThresh(state, 1000);
+
+            NS_TEST_EXPECT_MSG_EQ(state->m_cWnd,
+                m_expectedCwnd,
+                "Reduction caused by "
+                    << TcpSocketState::ReductionCauseName[m_cause]
+                    << " should apply " << (m_expectedCwnd == 850 ? "BetaEcn" : "Beta"));
+        }
+};
+
+/**
+ * Test case for adaptive ABE
+ */
+class TcpAbeAdaptiveTest : public TestCase
+{
+    private:
+        uint32_t m_markedBytes;//!<Bytes acked with ECE out of a window of 1000 bytes
+        uint32_t m_expectedCwnd;//!<Expected congestion window after applying the adaptive BetaEcn
+
+    public:
+        /**
+        * @brief Constructor
+        *
+        * @param markedBytes bytes acked with ECE out of a window of 1000 bytes
+        * @param expectedCwnd expected slow start threshold of CUBIC with 1000 segments
+        * @param desc Description about the congestion window reduction
+        */
+        TcpAbeAdaptiveTest(
+            uint32_t markedBytes,
+            uint32_t expectedCwnd,
+            const std::string& desc) :
+                TestCase(desc),
+                m_markedBytes(markedBytes),
+                m_expectedCwnd(expectedCwnd)
+            {}
+
+        void DoRun() override
+        {
+            Ptr<TcpCubic> cubic = CreateObject<TcpCubic>();
+            Ptr<TcpSocketState> state = CreateObject<TcpSocketState>();
+
+            //Configure TCP state, a gain of 1 keeps only the last window
+            state->m_enableAbe=true;
+            state->m_abeAdaptive=true;
+            state->m_abeGain=1.0;
+            state->m_highTxMark=SequenceNumber32(1000);
+
+            //Ack one window of 1000 bytes, the first markedBytes with ECE
+            if (m_markedBytes > 0)
+            {
+                TcpAbeBackoff::UpdateMarkFraction(state, SequenceNumber32(m_markedBytes), m_markedBytes, m_markedBytes);
+            }
+            TcpAbeBackoff::UpdateMarkFraction(state, SequenceNumber32(1000), 1000 - m_markedBytes, 0);
+            NS_TEST_EXPECT_MSG_EQ_TOL(state->m_abeMarkFraction.Get(),
+                m_markedBytes / 1000.0,
+                1e-9,
+                "Marking rate should be the fraction of bytes acked with ECE");
+
+            //update cwnd
+            state->m_ecnState=TcpSocketState::ECN_ECE_RCVD;
+            state->m_reductionCause=TcpSocketState::REDUCTION_ECN;
+            state->m_segmentSize=1;
+            state->m_cWnd=1000;
+            state->m_cWnd=cubic->GetSsThresh(state, 1000);
+
+            NS_TEST_EXPECT_MSG_EQ(state->m_cWnd,
+                m_expectedCwnd,
+                "CUBIC with adaptive ABE should apply the BetaEcn picked from the marking rate");
+        }
+};
+
+/**
+ * Test case for AccECN feedback of CE counters
+ */
+class TcpAbeAccEcnTest : public TestCase
+{
+    private:
+        uint32_t m_ceBytes;//!<CE-marked bytes reported out of a window of 1000 bytes
+        uint32_t m_expectedCwnd;//!<Expected congestion window after applying the adaptive BetaEcn
+
+    public:
+        /**
+        * @brief Constructor
+        *
+        * @param ceBytes CE-marked bytes reported out of a window of 1000 bytes
+        * @param expectedCwnd expected slow start threshold of CUBIC with 1000 segments
+        * @param desc Description about the congestion window reduction
+        */
+        TcpAbeAccEcnTest(
+            uint32_t ceBytes,
+            uint32_t expectedCwnd,
+            const std::string& desc) :
+                TestCase(desc),
+                m_ceBytes(ceBytes),
+                m_expectedCwnd(expectedCwnd)
+            {}
+
+        void DoRun() override
+        {
+            //Counters are sent modulo 2^24 and survive a serialization
+            Ptr<TcpOptionAccEcn> option = CreateObject<TcpOptionAccEcn>();
+            option->SetCeBytes(0x1000000 + m_ceBytes);
+            option->SetCePackets(0xffffff);
+            Buffer buffer;
+            buffer.AddAtStart(option->GetSerializedSize());
+            option->Serialize(buffer.Begin());
+            Ptr<TcpOptionAccEcn> read = CreateObject<TcpOptionAccEcn>();
+            NS_TEST_ASSERT_MSG_EQ(read->Deserialize(buffer.Begin()), 10, "AccECN option should be 10 bytes");
+            NS_TEST_EXPECT_MSG_EQ(read->IsAccEcn(), true, "AccECN option should carry its ExID");
+            NS_TEST_EXPECT_MSG_EQ(read->GetCeBytes(), m_ceBytes, "r.ceb should wrap at 2^24");
+            NS_TEST_EXPECT_MSG_EQ(read->GetCePackets(), 0xffffff, "r.cep should be read back");
+
+            //Another experiment sharing kind 253 is skipped, not read as CE counters
+            Buffer other;
+            other.AddAtStart(6);
+            Buffer::Iterator it = other.Begin();
+            it.WriteU8(TcpOption::EXP1);
+            it.WriteU8(6);
+            it.WriteHtonU16(0x1234);
+            it.WriteHtonU16(0xffff);
+            Ptr<TcpOptionAccEcn> foreign = CreateObject<TcpOptionAccEcn>();
+            NS_TEST_ASSERT_MSG_EQ(foreign->Deserialize(other.Begin()), 6, "Other experiments should be skipped whole");
+            NS_TEST_EXPECT_MSG_EQ(foreign->IsAccEcn(), false, "Other experiments should not be read as AccECN");
+
+            Ptr<TcpCubic> cubic = CreateObject<TcpCubic>();
+            Ptr<TcpSocketState> state = CreateObject<TcpSocketState>();
+
+            //Configure TCP state, a gain of 1 keeps only the last window
+            state->m_enableAbe=true;
+            state->m_abeAdaptive=true;
+            state->m_abeGain=1.0;
+            state->m_highTxMark=SequenceNumber32(1000);
+
+            //Ack one window of 1000 bytes in 4 ACKs, the first one reporting every
+            //CE-marked byte, as ECE would have been set on all of them
+            TcpAbeBackoff::UpdateMarkFraction(state, SequenceNumber32(250), 250, m_ceBytes);
+            TcpAbeBackoff::UpdateMarkFraction(state, SequenceNumber32(500), 250, 0);
+            TcpAbeBackoff::UpdateMarkFraction(state, SequenceNumber32(750), 250, 0);
+            TcpAbeBackoff::UpdateMarkFraction(state, SequenceNumber32(1000), 250, 0);
+            NS_TEST_EXPECT_MSG_EQ_TOL(state->m_abeMarkFraction.Get(),
+                m_ceBytes / 1000.0,
+                1e-9,
+                "Marking rate should be the fraction of bytes reported as CE-marked");
+
+            //update cwnd
+            state->m_ecnState=TcpSocketState::ECN_ECE_RCVD;
+            state->m_reductionCause=TcpSocketState::REDUCTION_ECN;
+            state->m_segmentSize=1;
+            state->m_cWnd=1000;
+            state->m_cWnd=cubic->GetSsThresh(state, 1000);
+
+            NS_TEST_EXPECT_MSG_EQ(state->m_cWnd,
+                m_expectedCwnd,
+                "CUBIC with AccECN should apply the BetaEcn picked from the CE byte count");
+        }
+};
+
 /**
  * Test suite for ABE
  */
@@ -257,6 +533,114 @@ public:
                                             100,
                                             "Test Linux Reno ABE with BetaEcn"),
                         TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpNewReno::GetTypeId(),
+                                          false,
+                                          1000,
+                                          500,
+                                          1000,
+                                          "Test NewReno without ABE"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpNewReno::GetTypeId(),
+                                          true,
+                                          1000,
+                                          700,
+                                          1000,
+                                          "Test NewReno ABE with BetaEcn"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpBic::GetTypeId(),
+                                          false,
+                                          1000,
+                                          800,
+                                          1000,
+                                          "Test BIC without ABE"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpBic::GetTypeId(),
+                                          true,
+                                          1000,
+                                          900,
+                                          1000,
+                                          "Test BIC ABE with BetaEcn"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpBic::GetTypeId(),
+                                          false,
+                                          10,
+                                          5,
+                                          10,
+                                          "Test BIC below LowWnd without ABE"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpBic::GetTypeId(),
+                                          true,
+                                          10,
+                                          7,
+                                          10,
+                                          "Test BIC ABE below LowWnd with Reno-scaled BetaEcn"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpHighSpeed::GetTypeId(),
+                                          false,
+                                          35,
+                                          17,
+                                          35,
+                                          "Test HighSpeed without ABE"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpHighSpeed::GetTypeId(),
+                                          true,
+                                          35,
+                                          24,
+                                          35,
+                                          "Test HighSpeed ABE with scaled decrease"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpScalable::GetTypeId(),
+                                          false,
+                                          100,
+                                          87,
+                                          100,
+                                          "Test Scalable without ABE"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeBackoffTest(
+                                          TcpScalable::GetTypeId(),
+                                          true,
+                                          100,
+                                          92,
+                                          100,
+                                          "Test Scalable ABE with scaled decrease"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeReductionCauseTest(
+                                                 TcpSocketState::REDUCTION_ECN,
+                                                 TcpSocketState::ECN_CWR_SENT,
+                                                 850,
+                                                 "Test ABE on ECN reduction after CWR was sent"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeReductionCauseTest(
+                                                 TcpSocketState::REDUCTION_FAST_RETRANSMIT,
+                                                 TcpSocketState::ECN_ECE_RCVD,
+                                                 700,
+                                                 "Test no ABE on fast retransmit with ECE set"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeReductionCauseTest(
+                                                 TcpSocketState::REDUCTION_RTO,
+                                                 TcpSocketState::ECN_ECE_RCVD,
+                                                 700,
+                                                 "Test no ABE on RTO with ECE set"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeAdaptiveTest(0, 900, "Test adaptive ABE without marks"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeAdaptiveTest(500, 700, "Test adaptive ABE with half of the bytes marked"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeAdaptiveTest(1000, 500, "Test adaptive ABE with every byte marked"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeAccEcnTest(100, 860, "Test AccECN with a tenth of the bytes marked"),
+                        TestCase::Duration::QUICK);
+        AddTestCase(new TcpAbeAccEcnTest(500, 700, "Test AccECN with half of the bytes marked"),
+                        TestCase::Duration::QUICK);
     }
 };
 